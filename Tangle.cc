@@ -1,15 +1,38 @@
 #include "Tangle.h"
 #include <iostream>
 #include <random>
-#include <chrono>
 #include <algorithm>
 #include <utility>
 #include <functional>
+#include <cstdint>
+#include <unordered_set>
+
+namespace
+{
+    // TxActor::ComputeWeight marks visited transactions with the current epoch, indexed by Tx::m_tangleIndex
+    thread_local std::vector<uint32_t> t_visitEpoch;
+    thread_local uint32_t t_epoch = 0;
+}
 
 int TxActor::actorCount;
 long int Tx::tx_totalCount;
 int Tangle::TangleGiveTipsCount;
 
+TipSelectionMethod tipSelectionMethodFromString( const std::string& method )
+{
+    if( method == "URTS" )
+    {
+        return TipSelectionMethod::URTS;
+    }
+
+    if( method == "WALK" )
+    {
+        return TipSelectionMethod::WALK;
+    }
+
+    return TipSelectionMethod::KWALK;
+}
+
 /*
     Tx DEFINITIONS
 */
@@ -20,7 +43,7 @@ bool Tx::hasApprovees()
     return m_TxApproved.size() > 0;
 }
 
-Tx::Tx() : m_walkBacktracks(0), TxNumber(tx_totalCount)
+Tx::Tx() : TxNumber(tx_totalCount)
 {
     tx_totalCount++;
 }
@@ -35,10 +58,11 @@ Tx::Tx() : m_walkBacktracks(0), TxNumber(tx_totalCount)
 Tangle::Tangle() try : m_genesisBlock( new Tx )
 {
      m_tips[m_genesisBlock->TxNumber] =  m_genesisBlock;
-     unsigned tipSelectSeed;
-     tipSelectSeed = std::chrono::system_clock::now().time_since_epoch().count(); //needs to use seeds from omnetpp
-     tipSelectGen.seed( tipSelectSeed );
+     m_genesisBlock->m_tipIndex = 0;
+     m_tipList.push_back( m_genesisBlock );
+     m_heightIndex.emplace_back( 1, m_genesisBlock );
      m_genesisBlock->isGenesisBlock = true;
+     stats.recordNewTx();
 }
 
 catch ( std::bad_alloc e)
@@ -61,10 +85,19 @@ void Tangle::ReconcileTips( const t_txApproved& removeTips )
     for(auto& tipSelected : removeTips)
     {
 
+        //approved through a view from before it expired, so it was not orphaned after all
+        if( tipSelected->isOrphaned )
+        {
+            tipSelected->isOrphaned = false;
+            --m_orphanCount;
+            stats.recordOrphanApproved();
+        }
+
         auto it = m_tips.find( tipSelected->TxNumber );
 
         if( it != m_tips.end() )
         {
+            removeFromTipList( it->second );
             m_tips.erase( it );
         }
     }
@@ -74,11 +107,184 @@ void Tangle::ReconcileTips( const t_txApproved& removeTips )
 //adds a pointer to a newly added but as yet unconfirmed Tx to the tip list
 void Tangle::addTip( t_ptrTx newTip )
 {
+     auto it = m_tips.find( newTip->TxNumber );
+
+     //keep m_tipList mirroring m_tips if the TxNumber is reused (counter reset after genesis creation)
+     if( it != m_tips.end() )
+     {
+         removeFromTipList( it->second );
+     }
+
      m_tips[newTip->TxNumber] = newTip;
+     newTip->m_tipIndex = m_tipList.size();
+     m_tipList.push_back( newTip );
+
+     for( auto& approved : newTip->m_TxApproved )
+     {
+         newTip->m_height = std::max( newTip->m_height, approved->m_height + 1 );
+     }
+
+     if( newTip->m_height >= m_heightIndex.size() )
+     {
+         m_heightIndex.resize( newTip->m_height + 1 );
+     }
+
+     m_heightIndex[newTip->m_height].push_back( newTip );
+
      allTx.push_back( newTip );
+     newTip->m_tangleIndex = allTx.size();
+
+     if( m_tipExpiry > 0 )
+     {
+         pushTipAge( newTip );
+     }
+}
+
+namespace
+{
+    // Puts the oldest timeStamp at the front of Tangle::m_tipAges
+    bool isYounger( const t_ptrTx& left, const t_ptrTx& right )
+    {
+        return left->timeStamp > right->timeStamp;
+    }
+}
+
+void Tangle::pushTipAge( t_ptrTx tip )
+{
+     m_tipAges.push_back( tip );
+     std::push_heap( m_tipAges.begin(), m_tipAges.end(), isYounger );
+}
+
+void Tangle::setTipExpiry( omnetpp::simtime_t expiry )
+{
+     bool wasEnabled = m_tipExpiry > 0;
+     m_tipExpiry = expiry;
+
+     //tips added while expiry was off are not in the age index yet
+     if( m_tipExpiry > 0 && !wasEnabled )
+     {
+         m_tipAges.clear();
+
+         for( auto& tip : m_tipList )
+         {
+             pushTipAge( tip );
+         }
+     }
+}
+
+int Tangle::expireTips( omnetpp::simtime_t now )
+{
+     if( m_tipExpiry <= 0 )
+     {
+         return 0;
+     }
+
+     int expired = 0;
+
+     while( !m_tipAges.empty() && now - m_tipAges.front()->timeStamp > m_tipExpiry )
+     {
+         t_ptrTx oldest = m_tipAges.front();
+
+         //still a tip, but keep at least one so tip selection always has something to approve
+         if( oldest->m_tipIndex >= 0 && m_tipList.size() <= 1 )
+         {
+             break;
+         }
+
+         std::pop_heap( m_tipAges.begin(), m_tipAges.end(), isYounger );
+         m_tipAges.pop_back();
+
+         if( oldest->m_tipIndex < 0 )
+         {
+             continue;
+         }
+
+         auto it = m_tips.find( oldest->TxNumber );
+
+         if( it != m_tips.end() && it->second == oldest )
+         {
+             m_tips.erase( it );
+         }
+
+         removeFromTipList( oldest );
+         oldest->isOrphaned = true;
+
+         ++m_orphanCount;
+         ++expired;
+         stats.recordOrphan();
+     }
+
+     return expired;
 }
 
-std::mt19937& Tangle::getRandGen()
+omnetpp::simtime_t Tangle::getTipExpiry() const
+{
+     return m_tipExpiry;
+}
+
+long Tangle::getOrphanCount() const
+{
+     return m_orphanCount;
+}
+
+void Tangle::removeFromTipList( t_ptrTx tip )
+{
+     if( tip->m_tipIndex < 0 )
+     {
+         return;
+     }
+
+     t_ptrTx last = m_tipList.back();
+     m_tipList[tip->m_tipIndex] = last;
+     last->m_tipIndex = tip->m_tipIndex;
+     m_tipList.pop_back();
+
+     tip->m_tipIndex = -1;
+}
+
+t_ptrTx Tangle::giveRandomTip()
+{
+     assert( m_tipList.size() > 0 );
+
+     return m_tipList[tipSelectGen.bounded( m_tipList.size() )];
+}
+
+t_txApproved Tangle::giveRandomTips()
+{
+     t_txApproved chosenTips;
+     unsigned toChoose = std::min<std::size_t>( APPROVE_VAL, m_tipList.size() );
+
+     while( chosenTips.size() < toChoose )
+     {
+         t_ptrTx tip = giveRandomTip();
+
+         if( !chosenTips.contains( tip ) )
+         {
+             chosenTips.push_back( tip );
+         }
+     }
+
+     return chosenTips;
+}
+
+t_ptrTx Tangle::giveDepthStart( int depth, omnetpp::simtime_t viewTime, TangleRng& gen )
+{
+     //a backtrack of depth steps from a tip lands at least depth layers below it
+     int height = std::max( 0, m_tipList[gen.bounded( m_tipList.size() )]->m_height - depth );
+     std::vector<t_ptrTx>& layer = m_heightIndex[height];
+
+     t_ptrTx start = layer[gen.bounded( layer.size() )];
+
+     //timestamps strictly decrease along approvals, so stepping back always reaches a visible Tx
+     while( start->timeStamp > viewTime && !start->isGenesisBlock )
+     {
+         start = start->m_TxApproved[gen.bounded( start->m_TxApproved.size() )];
+     }
+
+     return start;
+}
+
+TangleRng& Tangle::getRandGen()
 {
     return tipSelectGen;
 }
@@ -88,6 +294,54 @@ int Tangle::getTipNumber()
     return m_tips.size();
 }
 
+bool Tangle::setStorage( const std::string& path, std::size_t residentTx )
+{
+     m_residentTx = residentTx;
+
+     //a few MB per chunk keeps the number of mappings small without making eviction too coarse
+     return m_txStore.open( path, sizeof( Tx ), std::size_t( 1 ) << 22 );
+}
+
+t_ptrTx Tangle::createTx()
+{
+
+     if( !m_txStore.isOpen() )
+     {
+          return new Tx();
+     }
+
+     //slots are sizeof( Tx ) apart from a page aligned base, so each is aligned for a Tx
+     t_ptrTx tx = new( m_txStore.allocate() ) Tx();
+
+     if( m_txStore.size() > m_residentTx )
+     {
+          m_txStore.evictBefore( m_txStore.size() - m_residentTx );
+     }
+
+     return tx;
+
+}
+
+void Tangle::destroyTx( t_ptrTx tx )
+{
+
+     //the genesis block and anything created before setStorage are on the heap
+     if( m_txStore.contains( tx ) )
+     {
+          tx->~Tx();
+     }
+     else
+     {
+          delete tx;
+     }
+
+}
+
+std::size_t Tangle::getEvictedChunks() const
+{
+     return m_txStore.getEvictedChunks();
+}
+
 const t_ptrTx& Tangle::giveGenBlock() const
 {
     return m_genesisBlock;
@@ -114,8 +368,7 @@ t_txApproved TxActor::URTipSelection( std::map<int, t_ptrTx> tips )
      {
          if(tips.size() > 0)
          {
-             std::uniform_int_distribution<int> tipDist( 0, tips.size() -1 );
-             int iterAdvances = tipDist( getTanglePtr()->getRandGen() );
+             int iterAdvances = getRandGen().bounded( tips.size() );
 
              assert(iterAdvances < tips.size());
 
@@ -145,8 +398,9 @@ void TxActor::attach( std::map<int, t_ptrTx>& storedTips, omnetpp::simtime_t att
      {
 
          //create new tx
-         m_MyTx.emplace_back( new Tx() );
+         m_MyTx.emplace_back( getTanglePtr()->createTx() );
          m_MyTx.back()->m_issuedBy = this;
+         m_MyTx.back()->m_region = m_region;
          m_MyTx.back()->timeStamp = attachTime;
 
 
@@ -154,6 +408,7 @@ void TxActor::attach( std::map<int, t_ptrTx>& storedTips, omnetpp::simtime_t att
          for ( auto& tipSelected : chosen )
          {
 
+             getTanglePtr()->stats.recordApproval( tipSelected->m_approvedBy.size() );
              tipSelected->m_approvedBy.push_back( m_MyTx.back() );
 
              if( !( tipSelected->isApproved ) )
@@ -161,6 +416,8 @@ void TxActor::attach( std::map<int, t_ptrTx>& storedTips, omnetpp::simtime_t att
                  //with firstApprovedTime and timeAttached as field - we can compute the age of a transaction
                  tipSelected->firstApprovedTime = attachTime;
                  tipSelected->isApproved = true;
+
+                 getTanglePtr()->stats.recordTipAge( attachTime - tipSelected->timeStamp, attachTime );
              }
 
          }
@@ -173,6 +430,9 @@ void TxActor::attach( std::map<int, t_ptrTx>& storedTips, omnetpp::simtime_t att
          //add newly created Tx to Tangle tips list
          getTanglePtr()->addTip( m_MyTx.back() );
 
+         getTanglePtr()->stats.recordNewTx();
+         getTanglePtr()->stats.recordTipCount( getTanglePtr()->getTipNumber(), attachTime );
+
      }
      catch ( std::bad_alloc& e )
      {
@@ -182,8 +442,19 @@ void TxActor::attach( std::map<int, t_ptrTx>& storedTips, omnetpp::simtime_t att
 
 }
 
+TangleRng& TxActor::getRandGen()
+{
+    return m_ownRandGen ? m_randGen : getTanglePtr()->getRandGen();
+}
+
+void TxActor::seedRandGen( uint64_t seed )
+{
+    m_randGen.seed( seed );
+    m_ownRandGen = true;
+}
+
 //getter and setter for tangle pointer, makes it easy to interact with the tips
- Tangle* TxActor::getTanglePtr() const
+Tangle* TxActor::getTanglePtr() const
 {
     return tanglePtr;
 }
@@ -198,65 +469,58 @@ const std::vector<t_ptrTx>& TxActor::getMyTx() const
     return m_MyTx;
 }
 
+void TxActor::forgetMyTx()
+{
+    m_MyTx.clear();
+}
+
 //compute weight definitions
 
 //indirect recursion, start point here - calls private recursive function _computeWeight
 int TxActor::ComputeWeight( t_ptrTx tx, omnetpp::simtime_t timeStamp )
 {
 
-    std::vector<t_ptrTx> visited;
-    int weight = _computeWeight( visited, tx, timeStamp );
-
-    //leave txes as we found them
-    for( int i = 0; i < visited.size(); ++i )
+    //marking with a fresh epoch leaves nothing to reset afterwards
+    if( t_visitEpoch.size() < getTanglePtr()->allTx.size() + 1 )
     {
+        t_visitEpoch.resize( getTanglePtr()->allTx.size() + 1, 0 );
+    }
 
-        for( int j = 0; j < visited.at( i )->m_approvedBy.size(); ++j )
-        {
-            visited.at( i )->m_approvedBy.at( j )->isVisited = false;
-        }
-
+    if( ++t_epoch == 0 )
+    {
+        std::fill( t_visitEpoch.begin(), t_visitEpoch.end(), 0 );
+        t_epoch = 1;
     }
 
-    tx->isVisited = false;
-    return weight + 1;
+    t_visitEpoch[tx->m_tangleIndex] = t_epoch;
+
+    return _computeWeight( t_visitEpoch, t_epoch, tx, timeStamp ) + 1;
 
 }
 
 //traverses tangle returns weight of each transaction, stopping cases: previously visited transaction, transaction with
 //a timestamp after TxActor started computing, and on reaching a tip
-int TxActor::_computeWeight( std::vector<t_ptrTx>& visited, t_ptrTx& current, omnetpp::simtime_t timeStamp )
+int TxActor::_computeWeight( std::vector<uint32_t>& visitEpoch, uint32_t epoch, t_ptrTx current, omnetpp::simtime_t timeStamp )
 {
 
     //could TxActor "see" the current Tx their walk is located on?
-    if( timeStamp < current->timeStamp )
+    if( !sees( current, timeStamp ) )
     {
-        visited.push_back( current );
-        current->isVisited = true;
         return 0;
     }
 
-    //if we reach a tip
-    if( current->m_approvedBy.size() == 0 )
-    {
-        visited.push_back( current );
-        current->isVisited = true;
-
-        return 0;
-    }
-
-    visited.push_back( current );
-
-    current->isVisited = true;
     int weight = 0;
 
     for( int i = 0; i < current->m_approvedBy.size(); ++i )
     {
 
-        if( !current->m_approvedBy.at( i )->isVisited )
+        t_ptrTx approver = current->m_approvedBy[i];
+
+        //check if next tx has been visited before
+        if( visitEpoch[approver->m_tangleIndex] != epoch )
         {
-                //check if next tx has been visited before
-                weight += 1 + _computeWeight( visited, current->m_approvedBy.at( i ), timeStamp );
+                visitEpoch[approver->m_tangleIndex] = epoch;
+                weight += 1 + _computeWeight( visitEpoch, epoch, approver, timeStamp );
         }
 
     }
@@ -268,8 +532,7 @@ int TxActor::_computeWeight( std::vector<t_ptrTx>& visited, t_ptrTx& current, om
 t_ptrTx TxActor::getWalkStart( std::map<int, t_ptrTx>& tips, int backTrackDist )
 {
 
-    std::uniform_int_distribution<int> tipDist( 0, tips.size() -1 );
-    int iterAdvances = tipDist( getTanglePtr()->getRandGen() );
+    int iterAdvances = getRandGen().bounded( tips.size() );
 
     assert( iterAdvances < tips.size() );
 
@@ -290,8 +553,7 @@ t_ptrTx TxActor::getWalkStart( std::map<int, t_ptrTx>& tips, int backTrackDist )
     while( !current->isGenesisBlock && count > 0 )
     {
 
-        std::uniform_int_distribution<int> choice( 0, current->m_TxApproved.size() -1 );
-        approvesIndex = choice( getTanglePtr()->getRandGen() ) ;
+        approvesIndex = getRandGen().bounded( current->m_TxApproved.size() );
 
         assert( approvesIndex < current->m_TxApproved.size() );
 
@@ -306,6 +568,29 @@ t_ptrTx TxActor::getWalkStart( std::map<int, t_ptrTx>& tips, int backTrackDist )
 
 }
 
+t_ptrTx TxActor::getWalkStart( std::map<int, t_ptrTx>& tips, int backTrackDist, omnetpp::simtime_t timeStamp )
+{
+    if( m_indexedWalkStart )
+    {
+        t_ptrTx start = getTanglePtr()->giveDepthStart( backTrackDist, timeStamp, getRandGen() );
+
+        //issued by timeStamp but maybe not propagated here yet, its ancestors arrive no later
+        while( !sees( start, timeStamp ) && !start->isGenesisBlock )
+        {
+            start = start->m_TxApproved[getRandGen().bounded( start->m_TxApproved.size() )];
+        }
+
+        return start;
+    }
+
+    return getWalkStart( tips, backTrackDist );
+}
+
+void TxActor::setIndexedWalkStart( bool indexed )
+{
+    m_indexedWalkStart = indexed;
+}
+
 t_ptrTx TxActor::WalkTipSelection( t_ptrTx start, double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp )
 {
 
@@ -315,7 +600,7 @@ t_ptrTx TxActor::WalkTipSelection( t_ptrTx start, double alphaVal, std::map<int,
     t_ptrTx current = start;
 
     //keep going until we reach a "tip" in relation to the view of the tangle that TxActor has
-    while( !isRelativeTip( current, tips ) )
+    while( !isRelativeTip( current, tips, timeStamp ) )
     {
 
         ++walkCounts;
@@ -355,9 +640,7 @@ t_ptrTx TxActor::WalkTipSelection( t_ptrTx start, double alphaVal, std::map<int,
             else
             {
                 // if at least one non heaviest still available pick between them
-                std::uniform_real_distribution<double> walkChoice( 0.0, 1.0 );
-
-                if( walkChoice( getTanglePtr()->getRandGen() ) < alphaVal)
+                if( getRandGen().uniform() < alphaVal)
                 {
                     current = heaviestTx;
                 }
@@ -373,8 +656,7 @@ t_ptrTx TxActor::WalkTipSelection( t_ptrTx start, double alphaVal, std::map<int,
                     else
                     {
                         //otherwise pick at random
-                        std::uniform_int_distribution<int> siteChoice( 0, currentView.size() - 1 );
-                        int choiceIndex = siteChoice( getTanglePtr()->getRandGen() );
+                        int choiceIndex = getRandGen().bounded( currentView.size() );
                         current = currentView.at( choiceIndex );
 
                     }
@@ -405,6 +687,108 @@ bool TxActor::isRelativeTip( t_ptrTx& toCheck, std::map<int, t_ptrTx>& tips )
 
 }
 
+bool TxActor::isRelativeTip( t_ptrTx& toCheck, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp )
+{
+
+    //expired since the view was taken, the walk has to end somewhere else
+    if( toCheck->isOrphaned )
+    {
+        return false;
+    }
+
+    if( !getTanglePtr()->visibility.isEnabled() )
+    {
+        return isRelativeTip( toCheck, tips );
+    }
+
+    for( auto& approver : toCheck->m_approvedBy )
+    {
+        if( sees( approver, timeStamp ) && !approver->isOrphaned )
+        {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+bool TxActor::sees( t_ptrTx tx, omnetpp::simtime_t timeStamp ) const
+{
+
+    const TangleVisibility& visibility = getTanglePtr()->visibility;
+
+    if( !visibility.isEnabled() || tx->isGenesisBlock )
+    {
+        return tx->timeStamp <= timeStamp;
+    }
+
+    return visibility.isVisible( tx->timeStamp, tx->m_region, m_region, timeStamp );
+
+}
+
+void TxActor::filterTipView( std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp )
+{
+
+    if( !getTanglePtr()->visibility.isEnabled() )
+    {
+        return;
+    }
+
+    std::vector<t_ptrTx> hidden;
+
+    for( auto it = tips.begin(); it != tips.end(); )
+    {
+        if( sees( it->second, timeStamp ) )
+        {
+            ++it;
+        }
+        else
+        {
+            hidden.push_back( it->second );
+            it = tips.erase( it );
+        }
+    }
+
+    //step back from each hidden tip until reaching txes this TxActor sees, delays are short so this stays shallow
+    std::unordered_set<t_ptrTx> checked;
+
+    while( !hidden.empty() )
+    {
+        t_ptrTx tx = hidden.back();
+        hidden.pop_back();
+
+        for( auto& approved : tx->m_TxApproved )
+        {
+            if( !checked.insert( approved ).second )
+            {
+                continue;
+            }
+
+            if( !sees( approved, timeStamp ) )
+            {
+                hidden.push_back( approved );
+            }
+            else if( isRelativeTip( approved, tips, timeStamp ) )
+            {
+                tips[approved->TxNumber] = approved;
+            }
+        }
+    }
+
+}
+
+void TxActor::setRegion( int region )
+{
+    assert( region >= 0 && region <= UINT8_MAX );
+    m_region = region;
+}
+
+int TxActor::getRegion() const
+{
+    return m_region;
+}
+
 void TxActor::filterView( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp )
 {
 
@@ -412,7 +796,7 @@ void TxActor::filterView( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeSta
 
     for( int i = 0; i < view.size(); ++i )
     {
-        if( view.at( i )->timeStamp > timeStamp )
+        if( !sees( view.at( i ), timeStamp ) || view.at( i )->isOrphaned )
         {
             removeIndexes.push_back( i );
         }
@@ -428,14 +812,21 @@ void TxActor::filterView( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeSta
 
 }
 
-int TxActor::findMaxWeightIndex(std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp )
+int TxActor::findMaxWeightIndex(std::vector<t_ptrTx>& view, omnetpp::simtime_t )
+{
+    //the exact loop keeps the last candidate heavier than maxWeight, which it never raises above 0. Every candidate
+    //counts itself so weighs at least 1, which decides the last one without expanding any cone
+    return view.empty() ? 0 : view.size() - 1;
+}
+
+int TxActor::findMaxWeightIndexExact( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp )
 {
     int maxWeight = 0;
     int maxWeightIndex = 0;
 
     for( int i = 0; i < view.size(); ++i )
     {
-        int weight = ComputeWeight( view.at( i ), timeStamp );
+        int weight = cachedWeight( view.at( i ), timeStamp );
 
         if( weight > maxWeight )
         {
@@ -447,9 +838,55 @@ int TxActor::findMaxWeightIndex(std::vector<t_ptrTx>& view, omnetpp::simtime_t t
     return maxWeightIndex;
 }
 
+int TxActor::cachedWeight( t_ptrTx tx, omnetpp::simtime_t timeStamp )
+{
+    if( !m_weightCacheActive || timeStamp != m_weightCacheTime )
+    {
+        return ComputeWeight( tx, timeStamp );
+    }
+
+    auto it = m_weightCache.find( tx );
+
+    if( it != m_weightCache.end() )
+    {
+        ++m_weightCacheHits;
+        return it->second;
+    }
+
+    ++m_weightCacheMisses;
+
+    int weight = ComputeWeight( tx, timeStamp );
+    m_weightCache.emplace( tx, weight );
+
+    return weight;
+}
+
+void TxActor::startWeightCache( omnetpp::simtime_t timeStamp )
+{
+    m_weightCache.clear();
+    m_weightCacheTime = timeStamp;
+    m_weightCacheActive = true;
+}
+
+void TxActor::clearWeightCache()
+{
+    m_weightCache.clear();
+    m_weightCacheActive = false;
+}
+
+long TxActor::getWeightCacheHits() const
+{
+    return m_weightCacheHits;
+}
+
+long TxActor::getWeightCacheMisses() const
+{
+    return m_weightCacheMisses;
+}
+
 //TxActor def END
 
-t_ptrTx TxActor::EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp )
+t_ptrTx TxActor::EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp, int* walkSteps )
 {
 
     // Used to determine the next Tx to walk to
@@ -458,7 +895,7 @@ t_ptrTx TxActor::EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<
     t_ptrTx current = start;
 
     //keep going until we reach a "tip" in relation to the view of the tangle that TxActor has
-    while( !isRelativeTip( current, tips ) )
+    while( !isRelativeTip( current, tips, timeStamp ) )
     {
 
         ++walkCounts;
@@ -484,9 +921,7 @@ t_ptrTx TxActor::EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<
         {
 
         // choose if calculate the weights of available transaction here
-        std::uniform_real_distribution<double> walkChoice( 0.0, 1.0 );
-
-            if( walkChoice( getTanglePtr()->getRandGen() ) < alphaVal)
+            if( getRandGen().uniform() < alphaVal)
             {
                 //if more than one find the max weight
                 //get heaviest tx to simplify choosing next
@@ -499,20 +934,49 @@ t_ptrTx TxActor::EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<
             {
 
                 //otherwise pick at random
-                std::uniform_int_distribution<int> siteChoice( 0, currentView.size() - 1 );
-                int choiceIndex = siteChoice( getTanglePtr()->getRandGen() );
+                int choiceIndex = getRandGen().bounded( currentView.size() );
                 current = currentView.at( choiceIndex );
 
             }
         }
     }
 
-    current->m_walkBacktracks = walkCounts;
+    if( walkSteps != nullptr )
+    {
+        *walkSteps = walkCounts;
+    }
 
     return current;
 
 }
 
+t_txApproved TxActor::selectTips( TipSelectionMethod method, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp, double alphaVal, int walkDepth, int kMultiplier )
+{
+    if( method == TipSelectionMethod::URTS )
+    {
+        return URTipSelection( tips );
+    }
+
+    if( method == TipSelectionMethod::KWALK )
+    {
+        return NKWalkTipSelection( alphaVal, tips, timeStamp, kMultiplier, walkDepth );
+    }
+
+    t_txApproved chosenTips;
+    startWeightCache( timeStamp );
+
+    for( int i = 0; i < APPROVE_VAL; ++i )
+    {
+        //get start point for each walk, then find a tip
+        t_ptrTx walkStart = getWalkStart( tips, walkDepth, timeStamp );
+        chosenTips.push_back( EasyWalkTipSelection( walkStart, alphaVal, tips, timeStamp ) );
+    }
+
+    clearWeightCache();
+
+    return chosenTips;
+}
+
 // Allows us to use walk tip selection with multiple walkers
 t_txApproved TxActor::NKWalkTipSelection( double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp, int kMultiplier, int backTrackDist)
 {
@@ -522,16 +986,27 @@ t_txApproved TxActor::NKWalkTipSelection( double alphaVal, std::map<int, t_ptrTx
     std::vector<t_ptrTx> vec_walkerResults;
     vec_walkerResults.reserve(walkers);
 
+    // Steps taken by the last walker to finish on each tip
+    std::unordered_map<t_ptrTx, int> walkSteps;
+
+    startWeightCache( timeStamp );
+
     // Let the walkers find the tips tips
     for( int i = 0; i < walkers; ++i )
     {
-        vec_walkerResults.push_back( EasyWalkTipSelection( getWalkStart( tips, backTrackDist ) , alphaVal, tips, timeStamp ) );
+        int steps = 0;
+        t_ptrTx tip = EasyWalkTipSelection( getWalkStart( tips, backTrackDist, timeStamp ) , alphaVal, tips, timeStamp, &steps );
+
+        vec_walkerResults.push_back( tip );
+        walkSteps[tip] = steps;
     }
 
+    clearWeightCache();
+
     // Sort tips by how many steps the walker made - ascending order
-    std::sort( vec_walkerResults.begin(), vec_walkerResults.end(), [] ( t_ptrTx left, t_ptrTx right )
+    std::sort( vec_walkerResults.begin(), vec_walkerResults.end(), [&walkSteps] ( t_ptrTx left, t_ptrTx right )
         {
-            return left->m_walkBacktracks > right->m_walkBacktracks;
+            return walkSteps.at( left ) > walkSteps.at( right );
         }
     );
 
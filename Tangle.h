@@ -1,23 +1,133 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <map>
+#include <string>
+#include <unordered_map>
 #include <utility>
 
 #include <random>
 #include <ctime>
 #include <omnetpp.h>
 
+#include "TangleRng.h"
+#include "TangleStats.h"
+#include "TangleStorage.h"
+#include "TangleVisibility.h"
+
 
 struct Tx;
 class Tangle;
 class TxActor;
 
-const unsigned int APPROVE_VAL = 2;
+// How many transactions each new transaction approves. Set at build time with -DTANGLE_APPROVE_VAL=<n> to study
+// tangles with more parents, Tx keeps its parents inline so the count has to be fixed per build
+#ifndef TANGLE_APPROVE_VAL
+#define TANGLE_APPROVE_VAL 2
+#endif
+
+static_assert( TANGLE_APPROVE_VAL >= 2 && TANGLE_APPROVE_VAL <= 8, "TANGLE_APPROVE_VAL must be between 2 and 8" );
+
+const unsigned int APPROVE_VAL = TANGLE_APPROVE_VAL;
+
+// Tip selection + attach methods selectable through the tipSelectionMethod parameter
+enum class TipSelectionMethod { URTS, WALK, KWALK };
+
+// "URTS" and "WALK" map to their methods, anything else is KWALK
+TipSelectionMethod tipSelectionMethodFromString( const std::string& method );
 
 using t_ptrTx = Tx*;
-using t_txApproved = std::vector<t_ptrTx>;
+
+// Fixed capacity list of up to N transactions stored inline, used for the parents of a Tx so they need no
+// allocation of their own. Only N = APPROVE_VAL is used, the count is fixed per build
+template <unsigned N>
+class ParentList
+{
+
+    public:
+        using value_type = t_ptrTx;
+        using iterator = t_ptrTx*;
+        using const_iterator = const t_ptrTx*;
+
+        ParentList() = default;
+
+        template <typename InputIt>
+        ParentList( InputIt first, InputIt last )
+        {
+            for( ; first != last; ++first )
+            {
+                push_back( *first );
+            }
+        }
+
+        static constexpr unsigned capacity() { return N; }
+
+        std::size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        void push_back( t_ptrTx tx )
+        {
+            assert( m_size < N );
+            m_items[m_size++] = tx;
+        }
+
+        void clear() { m_size = 0; }
+
+        t_ptrTx& operator[]( std::size_t i ) { return m_items[i]; }
+        const t_ptrTx& operator[]( std::size_t i ) const { return m_items[i]; }
+
+        t_ptrTx& at( std::size_t i )
+        {
+            assert( i < m_size );
+            return m_items[i];
+        }
+
+        const t_ptrTx& at( std::size_t i ) const
+        {
+            assert( i < m_size );
+            return m_items[i];
+        }
+
+        t_ptrTx& front() { return m_items[0]; }
+        t_ptrTx& back() { return m_items[m_size - 1]; }
+
+        iterator begin() { return m_items.data(); }
+        iterator end() { return m_items.data() + m_size; }
+        const_iterator begin() const { return m_items.data(); }
+        const_iterator end() const { return m_items.data() + m_size; }
+
+        iterator erase( iterator first, iterator last )
+        {
+            iterator newEnd = std::move( last, end(), first );
+            m_size = newEnd - begin();
+            return first;
+        }
+
+        // Compares against every slot rather than stopping early, a fixed N iterations
+        bool contains( t_ptrTx tx ) const
+        {
+            bool found = false;
+
+            for( unsigned i = 0; i < N; ++i )
+            {
+                found |= ( i < m_size ) & ( m_items[i] == tx );
+            }
+
+            return found;
+        }
+
+    private:
+        std::array<t_ptrTx, N> m_items{};
+        unsigned char m_size = 0;
+
+};
+
+using t_txApproved = ParentList<APPROVE_VAL>;
 
 struct Tx
 {
@@ -36,14 +146,23 @@ struct Tx
 	//Time this transaction ceased to be a tip
 	omnetpp::simtime_t firstApprovedTime;
 
-	int m_walkBacktracks;
-
 	bool isGenesisBlock = false;
 	bool isApproved = false;
 
-	// Only used by ComputeWeight and _computeWeight, set when the recursion visits this transaction
-	// reset to false in ComputeWeight
-	bool isVisited = false;
+	// Set when the tip expiry policy dropped this transaction from the tips before anyone approved it
+	bool isOrphaned = false;
+
+	// Position of this transaction in Tangle::m_tipList while it is a tip, -1 otherwise
+	int m_tipIndex = -1;
+
+	// Longest path back to the genesis block - 0 for genesis, otherwise one more than the highest Tx it approves
+	int m_height = 0;
+
+	// Dense index in attach order - 0 for genesis, i + 1 for Tangle::allTx[i]. Approvers always have a higher index
+	long int m_tangleIndex = 0;
+
+	// Region of the issuing TxActor, where the transaction starts propagating from - see TangleVisibility
+	uint8_t m_region = 0;
 
 	bool hasApprovees();
 
@@ -65,12 +184,36 @@ class Tangle
         // Keep a record of all the current unapproved transactions
         std::map<int, t_ptrTx> m_tips;
 
+        // Dense mirror of m_tips so a uniformly random tip can be drawn without walking the map
+        std::vector<t_ptrTx> m_tipList;
+
+        // Swap-and-pop removal from m_tipList using Tx::m_tipIndex
+        void removeFromTipList( t_ptrTx tip );
+
+        // m_heightIndex[h] holds every transaction with Tx::m_height == h, in attach order
+        std::vector<std::vector<t_ptrTx>> m_heightIndex;
+
+        // Tips older than this are dropped by expireTips, zero disables expiry
+        omnetpp::simtime_t m_tipExpiry;
+
+        // Min heap on Tx::timeStamp of every transaction added while expiry is enabled. Approved transactions
+        // are left in and skipped when they reach the top
+        std::vector<t_ptrTx> m_tipAges;
+        long m_orphanCount = 0;
+
+        void pushTipAge( t_ptrTx tip );
+
         // The first transaction - initialised on construction
         t_ptrTx m_genesisBlock;
 
         // RNG in tangle to simplify tip selection
         //TODO: Reimplement to take as a param from omnet ned file
-        std::mt19937 tipSelectGen;
+        TangleRng tipSelectGen;
+
+        // File backed storage for transactions once setStorage has opened it, otherwise they are allocated on the heap.
+        // The most recent m_residentTx are kept in memory, older chunks are evicted as the tangle grows
+        TxArena m_txStore;
+        std::size_t m_residentTx = 0;
 
     public:
         Tangle();
@@ -83,6 +226,12 @@ class Tangle
         //All transactions
         std::vector<t_ptrTx> allTx;
 
+        // Online tip age, tip count and approver distributions - updated by TxActor::attach
+        TangleStats stats;
+
+        // Region to region propagation delays, disabled unless configured
+        TangleVisibility visibility;
+
         // Returns a copy of the current tips from the Tangle (Needs to be a copy to simulate an asynchronous view of the tangle per transactor)
         std::map<int, t_ptrTx> giveTips();
 
@@ -93,9 +242,46 @@ class Tangle
         // Newly issued transaction is added to the list of unconfirmed transactions
         void addTip(t_ptrTx newTip);
 
-        // Returns ref to the RNG, used in all TxActor methods
-        // TODO: Needs refactoring, perhaps a static RNG for each use in TxActor?
-        std::mt19937& getRandGen();
+        // Tips with a timeStamp more than expiry before the time passed to expireTips are removed, zero disables
+        void setTipExpiry( omnetpp::simtime_t expiry );
+
+        // Drops tips older than the expiry from the tips and marks them orphaned, always leaving at least one tip.
+        // O(log n) per transaction removed from the age index, returns how many tips were dropped. An orphan
+        // approved later through an older tip view is no longer orphaned, see ReconcileTips
+        int expireTips( omnetpp::simtime_t now );
+
+        // How many tips expireTips has dropped that are still unapproved
+        long getOrphanCount() const;
+
+        omnetpp::simtime_t getTipExpiry() const;
+
+        // Returns a uniformly random tip from the current tips in O(1) - used where a full copy of the tips is too expensive
+        t_ptrTx giveRandomTip();
+
+        // Returns a random transaction roughly depth layers behind a random tip, without walking the tangle.
+        // Only transactions with a timeStamp up to viewTime are returned, so it is safe to start a walk from.
+        // Draws from gen, so callers with their own generator do not touch the tangle's
+        t_ptrTx giveDepthStart( int depth, omnetpp::simtime_t viewTime, TangleRng& gen );
+
+        // Picks min( APPROVE_VAL, tip count ) distinct tips uniformly at random from the current tips - the URTS
+        // kernel used where a copied tip view is not needed
+        t_txApproved giveRandomTips();
+
+        // Keeps transactions created from now on in a memory mapped file at path instead of on the heap, so tangles
+        // larger than memory can be built. Only the residentTx most recent are held in memory, older ones are paged
+        // back in when something reads them. False if the file cannot be created
+        bool setStorage( const std::string& path, std::size_t residentTx );
+
+        // Every Tx added to the tangle is made by createTx and must be released with destroyTx
+        t_ptrTx createTx();
+        void destroyTx( t_ptrTx tx );
+
+        // Chunks of the storage file written back and dropped from memory so far
+        std::size_t getEvictedChunks() const;
+
+        // Returns ref to the tangle's RNG, used by TxActors without a generator of their own. Seeded with 0 until
+        // the owner seeds it - from an OMNeT++ RNG stream in the simulation modules
+        TangleRng& getRandGen();
 
         // Return current number of unapproved transactions
         int getTipNumber();
@@ -119,8 +305,30 @@ class TxActor
         std::vector<t_ptrTx> m_MyTx;
         Tangle * tanglePtr = nullptr;
 
+        // Take walk start points from the Tangle's height index rather than backtracking from a tip
+        bool m_indexedWalkStart = false;
+
+        // Weights computed during the current tip selection, shared by all of its walkers. Only valid for
+        // m_weightCacheTime, the tangle is not modified while a selection runs so the entries cannot go stale
+        std::unordered_map<t_ptrTx, int> m_weightCache;
+        omnetpp::simtime_t m_weightCacheTime;
+        bool m_weightCacheActive = false;
+
+        long m_weightCacheHits = 0;
+        long m_weightCacheMisses = 0;
+
+        // ComputeWeight through the cache when one is active for timeStamp
+        int cachedWeight( t_ptrTx tx, omnetpp::simtime_t timeStamp );
+
+        // Region of the node this transactor runs on, only used when the tangle's visibility layer is enabled
+        uint8_t m_region = 0;
+
+        // Set by seedRandGen, tip selection then draws from m_randGen instead of the tangle's generator
+        TangleRng m_randGen;
+        bool m_ownRandGen = false;
+
         // Recursive func to compute cumulative weight of a transaction, called from public func ComputeWeight
-        int _computeWeight( std::vector<t_ptrTx>& visited, t_ptrTx& current, omnetpp::simtime_t timeStamp );
+        int _computeWeight( std::vector<uint32_t>& visitEpoch, uint32_t epoch, t_ptrTx current, omnetpp::simtime_t timeStamp );
 
     public:
         TxActor();
@@ -134,7 +342,12 @@ class TxActor
 
         //returns a tip to approve via a walk - randomness determined by param
         t_ptrTx WalkTipSelection( t_ptrTx start, double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp );
-        t_ptrTx EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp );
+        // walkSteps, if given, is set to the number of steps the walker took
+        t_ptrTx EasyWalkTipSelection( t_ptrTx start, double alphaVal, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp, int* walkSteps = nullptr );
+
+        // Runs the given tip selection method against tips as seen at timeStamp. WALK sends APPROVE_VAL walkers
+        // sharing one weight cache, KWALK defers to NKWalkTipSelection
+        t_txApproved selectTips( TipSelectionMethod method, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp, double alphaVal, int walkDepth, int kMultiplier );
 
         //Wrapper for Walk tip selection where k is the number of walkers to release into the tangle
         // first APPROVE_VAL back are the chosen tips
@@ -146,24 +359,68 @@ class TxActor
 
         void setTanglePtr( Tangle* tn );
 
+        // The generator tip selection draws from - the tangle's, unless seedRandGen has been called
+        TangleRng& getRandGen();
+
+        // Gives this transactor its own generator, so its tip selections can run alongside other transactors'
+        void seedRandGen( uint64_t seed );
+
         //Returns a reference to all the transactions this transaction has issued
         const std::vector<t_ptrTx>& getMyTx() const;
 
+        //Drops the record of issued transactions, for a TxActor reused to attach for many transactors
+        void forgetMyTx();
+
         //computes cumulative weight of any given transaction - used heavily in walk tip selection
-        //indirect recursion
+        //indirect recursion. Visits are marked in per thread storage, so concurrent calls on one tangle are safe
         int ComputeWeight( t_ptrTx tx, omnetpp::simtime_t timeStamp );
 
         //backtrack a determined distance in the tangle to find a start point for a random walk
         t_ptrTx getWalkStart( std::map<int, t_ptrTx>& tips, int backTrackDist );
 
+        //as above, but uses Tangle::giveDepthStart instead when indexed walk starts are enabled
+        t_ptrTx getWalkStart( std::map<int, t_ptrTx>& tips, int backTrackDist, omnetpp::simtime_t timeStamp );
+
+        void setIndexedWalkStart( bool indexed );
+
         //checks if TxActor sees the tx its walker is on as a tip
         bool isRelativeTip( t_ptrTx& toCheck, std::map<int, t_ptrTx>& tips );
 
+        //as above at timeStamp - with the visibility layer enabled a tx is a tip to this TxActor when none of its
+        //approvers have reached its region yet, whether or not the tangle still counts it as a tip. Never true
+        //for a tx the tip expiry has orphaned, and orphaned approvers are ignored
+        bool isRelativeTip( t_ptrTx& toCheck, std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp );
+
+        //removes the txes TxActor cannot see at timeStamp, and any orphaned by the tip expiry so walks do not step onto them
         void filterView( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp );
 
-        //Returns the index of the heaviest tx in the actors tip view
+        //can TxActor see tx at timeStamp - issued by then and, with the visibility layer enabled, propagated to its region
+        bool sees( t_ptrTx tx, omnetpp::simtime_t timeStamp ) const;
+
+        //turns a copy of the tangle's tips into the tips TxActor sees at timeStamp. Tips that have not reached its
+        //region yet are replaced by the txes they approve that it sees as tips. Does nothing without the visibility layer
+        void filterTipView( std::map<int, t_ptrTx>& tips, omnetpp::simtime_t timeStamp );
+
+        void setRegion( int region );
+        int getRegion() const;
+
+        //Returns the index of the tx walks treat as heaviest in the actors tip view - the same choice as
+        //findMaxWeightIndexExact, which is always the last candidate, decided without computing any weights
         int findMaxWeightIndex( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp );
 
+        //The comparison loop walks have always used, computing every candidate's full weight. Kept as the reference
+        //findMaxWeightIndex is checked against in tests/FindMaxWeightTest.cc
+        int findMaxWeightIndexExact( std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp );
+
+        // Bracket a tip selection so its walkers share weights computed at timeStamp, called by NKWalkTipSelection
+        // itself - callers running several walks by hand should wrap them
+        void startWeightCache( omnetpp::simtime_t timeStamp );
+        void clearWeightCache();
+
+        // Lifetime counts of weight lookups answered from / missing the cache
+        long getWeightCacheHits() const;
+        long getWeightCacheMisses() const;
+
         static int actorCount;
 
 };
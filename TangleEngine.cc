@@ -0,0 +1,165 @@
+#include "TangleEngine.h"
+
+#ifdef TANGLE_HAS_COROUTINES
+
+#include <algorithm>
+#include <exception>
+
+namespace
+{
+    // Orders the heap so the earliest wake time, then the earliest scheduled, is at the front
+    bool wakesLater( const ActorTask::promise_type* left, const ActorTask::promise_type* right )
+    {
+        return left->wakeTime > right->wakeTime || ( left->wakeTime == right->wakeTime && left->seq > right->seq );
+    }
+}
+
+/*
+    ACTORTASK DEFINITIONS
+*/
+
+ActorTask ActorTask::promise_type::get_return_object()
+{
+    return ActorTask( handle_t::from_promise( *this ) );
+}
+
+void ActorTask::promise_type::unhandled_exception()
+{
+    std::terminate();
+}
+
+ActorTask::ActorTask( handle_t handle ) : m_handle( handle )
+{
+}
+
+ActorTask::ActorTask( ActorTask&& other ) noexcept : m_handle( other.m_handle )
+{
+    other.m_handle = nullptr;
+}
+
+ActorTask::~ActorTask()
+{
+    //actors still waiting when the engine stops are destroyed suspended
+    if( m_handle )
+    {
+        m_handle.destroy();
+    }
+}
+
+//ActorTask def END
+
+/*
+    ACTORENGINE DEFINITIONS
+*/
+
+ActorEngine::ActorEngine( Tangle& tn, const Params& params )
+    : m_tangle( tn ), m_params( params ), m_gen( tn.getRandGen() ), m_txGenDist( 1.0 / params.meanTxGenTime )
+{
+    m_actors.resize( std::max( 1, m_params.actorCount ) );
+
+    m_tangle.getRandGen().seed( m_params.seed );
+
+    for( auto& actor : m_actors )
+    {
+        actor.setTanglePtr( &m_tangle );
+        actor.setIndexedWalkStart( m_params.indexedWalkStart );
+        actor.seedRandGen( m_tangle.getRandGen().next() );
+    }
+}
+
+void ActorEngine::Delay::await_suspend( ActorTask::handle_t handle )
+{
+    engine.schedule( handle.promise(), delay );
+}
+
+ActorEngine::Delay ActorEngine::delay( double delay )
+{
+    return { *this, delay };
+}
+
+void ActorEngine::schedule( ActorTask::promise_type& promise, double delay )
+{
+    promise.wakeTime = m_now + delay;
+    promise.seq = m_nextSeq++;
+
+    m_queue.push_back( &promise );
+    std::push_heap( m_queue.begin(), m_queue.end(), wakesLater );
+}
+
+long ActorEngine::run()
+{
+    m_tasks.reserve( m_actors.size() );
+
+    for( int i = 0; i < m_actors.size(); ++i )
+    {
+        m_tasks.push_back( actorLifecycle( i ) );
+    }
+
+    while( !m_queue.empty() && m_attached < m_params.txCount )
+    {
+        std::pop_heap( m_queue.begin(), m_queue.end(), wakesLater );
+        ActorTask::promise_type* next = m_queue.back();
+        m_queue.pop_back();
+
+        m_now = next->wakeTime;
+        ++m_events;
+
+        ActorTask::handle_t::from_promise( *next ).resume();
+    }
+
+    return m_attached;
+}
+
+double ActorEngine::now() const
+{
+    return m_now;
+}
+
+uint64_t ActorEngine::getEventCount() const
+{
+    return m_events;
+}
+
+ActorTask ActorEngine::actorLifecycle( int actor )
+{
+    TxActor& self = m_actors[actor];
+    std::map<int, t_ptrTx> actorTipView;
+    std::map<int, t_ptrTx> unusedTips;
+
+    while( true )
+    {
+        co_await delay( m_txGenDist( m_gen ) );
+
+        //the request travels to the tangle and the tips travel back
+        co_await delay( 2 * m_params.linkDelay );
+
+        double tipTime = m_now;
+        t_txApproved chosenTips;
+
+        m_tangle.expireTips( tipTime );
+
+        if( m_params.method == TipSelectionMethod::URTS )
+        {
+            //URTS only depends on the view, so choose now rather than holding a copy of the tips through POW
+            chosenTips = m_tangle.giveRandomTips();
+
+            co_await delay( m_params.powTime );
+        }
+        else
+        {
+            actorTipView = m_tangle.giveTips();
+
+            co_await delay( m_params.powTime );
+
+            chosenTips = self.selectTips( m_params.method, actorTipView, tipTime, m_params.alphaVal, m_params.walkDepth, m_params.kMultiplier );
+            actorTipView.clear();
+        }
+
+        self.attach( unusedTips, tipTime, chosenTips );
+        ++m_attached;
+    }
+}
+
+//ActorEngine def END
+
+#endif
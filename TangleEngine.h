@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Tangle.h"
+
+// The coroutine engine needs C++20, builds with an older standard get TANGLE_HAS_COROUTINES undefined and
+// TangleEngineModule reports it at runtime
+#if defined( __cpp_impl_coroutine ) && __has_include( <coroutine> )
+#define TANGLE_HAS_COROUTINES 1
+#include <coroutine>
+
+class ActorEngine;
+
+// One transactor's lifecycle, suspended on simulated delays. The frame doubles as the event queue entry -
+// wakeTime and seq live in the promise, so scheduling a delay allocates nothing
+class ActorTask
+{
+
+    public:
+        struct promise_type
+        {
+            double wakeTime = 0.0;
+            uint64_t seq = 0; // breaks ties in scheduling order
+
+            ActorTask get_return_object();
+
+            // run straight to the first delay, which puts the actor in the queue
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+
+            void return_void() {}
+            void unhandled_exception();
+        };
+
+        using handle_t = std::coroutine_handle<promise_type>;
+
+        explicit ActorTask( handle_t handle );
+        ActorTask( ActorTask&& other ) noexcept;
+        ActorTask( const ActorTask& ) = delete;
+        ActorTask& operator=( const ActorTask& ) = delete;
+        ~ActorTask();
+
+    private:
+        handle_t m_handle;
+
+};
+
+// Standalone discrete event engine where every transactor is a coroutine following the TxActorModule cycle:
+// wait txGenRate -> request tips (view arrives 2 * linkDelay later) -> POW -> attach. Events are promise
+// pointers in a binary heap, so an event costs a heap push / pop and a coroutine resume
+class ActorEngine
+{
+
+    public:
+        struct Params
+        {
+            long txCount = 0;
+            int actorCount = 1;
+            double meanTxGenTime = 1.0; // mean of the exponential wait between a transactor's transactions
+            double powTime = 0.1;
+            double linkDelay = 0.001;
+            TipSelectionMethod method = TipSelectionMethod::URTS;
+            double alphaVal = 0.5;
+            int walkDepth = 0;
+            int kMultiplier = 1;
+            bool indexedWalkStart = false;
+            uint64_t seed = 0;
+        };
+
+        // Awaitable returned by delay(), resumes the awaiting actor once simulated time has advanced by delay
+        struct Delay
+        {
+            ActorEngine& engine;
+            double delay;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend( ActorTask::handle_t handle );
+            void await_resume() const noexcept {}
+        };
+
+        ActorEngine( Tangle& tn, const Params& params );
+
+        // Runs until txCount transactions have been attached, returns how many were attached
+        long run();
+
+        double now() const;
+
+        // Events processed by the last run
+        uint64_t getEventCount() const;
+
+    private:
+        Tangle& m_tangle;
+        Params m_params;
+
+        std::vector<TxActor> m_actors;
+        std::vector<ActorTask> m_tasks;
+
+        // Min heap on ( wakeTime, seq ) of suspended actors
+        std::vector<ActorTask::promise_type*> m_queue;
+        uint64_t m_nextSeq = 0;
+        uint64_t m_events = 0;
+
+        double m_now = 0.0;
+        long m_attached = 0;
+
+        TangleRng& m_gen;
+        std::exponential_distribution<double> m_txGenDist;
+
+        Delay delay( double delay );
+        void schedule( ActorTask::promise_type& promise, double delay );
+
+        ActorTask actorLifecycle( int actor );
+
+};
+
+#endif
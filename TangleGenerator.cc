@@ -0,0 +1,273 @@
+#include "TangleGenerator.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <unordered_map>
+
+namespace
+{
+    const char TANGLE_FILE_MAGIC[8] = { 'T', 'A', 'N', 'G', 'L', 'E', '0', '1' };
+}
+
+/*
+    TANGLEGENERATOR DEFINITIONS
+*/
+
+TangleGenerator::TangleGenerator( Tangle& tn, const Params& params ) : m_tangle( tn ), m_params( params )
+{
+    m_actors.resize( std::max( 1, m_params.actorCount ) );
+
+    m_tangle.getRandGen().seed( m_params.seed );
+
+    //every issuer gets its own stream, drawn from the seeded tangle generator so the run still follows from seed
+    for( auto& actor : m_actors )
+    {
+        actor.setTanglePtr( &m_tangle );
+        actor.setIndexedWalkStart( m_params.indexedWalkStart );
+        actor.seedRandGen( m_tangle.getRandGen().next() );
+    }
+}
+
+long TangleGenerator::generate()
+{
+    TangleRng& gen = m_tangle.getRandGen();
+    std::exponential_distribution<double> arrivalDist( m_params.arrivalRate );
+
+    double now = 0.0;
+    long attached = m_tangle.allTx.size();
+
+    for( long i = 0; i < m_params.txCount; ++i )
+    {
+        now += arrivalDist( gen );
+
+        //the tangle must contain everything whose POW finished before this arrival looks at it
+        flushPending( now );
+        m_tangle.expireTips( now );
+
+        PendingTx pending;
+        pending.issueTime = now;
+        pending.attachAt = now + m_params.powDelay;
+        pending.actor = gen.bounded( m_actors.size() );
+        pending.chosen = selectTips( m_actors[pending.actor], now );
+
+        m_pending.push_back( std::move( pending ) );
+    }
+
+    flushPending( std::numeric_limits<double>::infinity() );
+
+    return m_tangle.allTx.size() - attached;
+}
+
+t_txApproved TangleGenerator::selectTips( TxActor& actor, double issueTime )
+{
+    if( m_params.method == TipSelectionMethod::URTS )
+    {
+        //sample straight from the tangle rather than a copied view, without replacement like URTipSelection
+        return m_tangle.giveRandomTips();
+    }
+
+    std::map<int, t_ptrTx> tipView = m_tangle.giveTips();
+
+    return actor.selectTips( m_params.method, tipView, issueTime, m_params.alphaVal, m_params.walkDepth, m_params.kMultiplier );
+}
+
+long TangleGenerator::getWeightCacheHits() const
+{
+    long hits = 0;
+
+    for( auto& actor : m_actors )
+    {
+        hits += actor.getWeightCacheHits();
+    }
+
+    return hits;
+}
+
+long TangleGenerator::getWeightCacheMisses() const
+{
+    long misses = 0;
+
+    for( auto& actor : m_actors )
+    {
+        misses += actor.getWeightCacheMisses();
+    }
+
+    return misses;
+}
+
+void TangleGenerator::flushPending( double now )
+{
+    while( !m_pending.empty() && m_pending.front().attachAt <= now )
+    {
+        PendingTx& pending = m_pending.front();
+        std::map<int, t_ptrTx> unusedTips;
+
+        m_actors[pending.actor].attach( unusedTips, pending.issueTime, pending.chosen );
+        m_pending.pop_front();
+    }
+}
+
+//TangleGenerator def END
+
+/*
+    TANGLE FILE DEFINITIONS
+
+    Layout: 8 byte magic, uint64 record count, uint32 issuer count, then per transaction in attach order
+    double timeStamp, uint32 issuer, uint8 approved count, int64 index of each approved Tx
+    where index 0 is the genesis block and index i is allTx[i - 1]
+*/
+
+bool writeTangleFile( const Tangle& tn, const std::string& filename )
+{
+    std::ofstream out( filename.c_str(), std::ios::binary | std::ios::trunc );
+
+    if( !out )
+    {
+        std::cerr << "Could not open " << filename << " to write tangle" << std::endl;
+        return false;
+    }
+
+    std::unordered_map<t_ptrTx, int64_t> txIndex;
+    std::unordered_map<const TxActor*, uint32_t> issuerIndex;
+
+    txIndex.reserve( tn.allTx.size() + 1 );
+    txIndex[tn.giveGenBlock()] = 0;
+
+    //number the issuers up front so the reader can size its transactors before attaching anything
+    for( auto& tx : tn.allTx )
+    {
+        issuerIndex.emplace( tx->m_issuedBy, issuerIndex.size() );
+    }
+
+    uint64_t count = tn.allTx.size();
+    uint32_t issuerCount = issuerIndex.size();
+
+    out.write( TANGLE_FILE_MAGIC, sizeof( TANGLE_FILE_MAGIC ) );
+    out.write( reinterpret_cast<const char*>( &count ), sizeof( count ) );
+    out.write( reinterpret_cast<const char*>( &issuerCount ), sizeof( issuerCount ) );
+
+    for( int64_t i = 0; i < tn.allTx.size(); ++i )
+    {
+        t_ptrTx tx = tn.allTx[i];
+        txIndex[tx] = i + 1;
+
+        auto issuer = issuerIndex.find( tx->m_issuedBy );
+
+        double timeStamp = tx->timeStamp.dbl();
+        uint8_t approvedCount = tx->m_TxApproved.size();
+
+        out.write( reinterpret_cast<const char*>( &timeStamp ), sizeof( timeStamp ) );
+        out.write( reinterpret_cast<const char*>( &issuer->second ), sizeof( issuer->second ) );
+        out.write( reinterpret_cast<const char*>( &approvedCount ), sizeof( approvedCount ) );
+
+        for( auto& approved : tx->m_TxApproved )
+        {
+            int64_t approvedIndex = txIndex.at( approved );
+            out.write( reinterpret_cast<const char*>( &approvedIndex ), sizeof( approvedIndex ) );
+        }
+    }
+
+    return static_cast<bool>( out );
+}
+
+bool readTangleFile( Tangle& tn, std::vector<TxActor>& actors, const std::string& filename )
+{
+    std::ifstream in( filename.c_str(), std::ios::binary );
+
+    if( !in )
+    {
+        std::cerr << "Could not open " << filename << " to read tangle" << std::endl;
+        return false;
+    }
+
+    char magic[sizeof( TANGLE_FILE_MAGIC )];
+    uint64_t count = 0;
+    uint32_t issuerCount = 0;
+
+    in.read( magic, sizeof( magic ) );
+    in.read( reinterpret_cast<char*>( &count ), sizeof( count ) );
+    in.read( reinterpret_cast<char*>( &issuerCount ), sizeof( issuerCount ) );
+
+    if( !in || !std::equal( magic, magic + sizeof( magic ), TANGLE_FILE_MAGIC ) )
+    {
+        std::cerr << filename << " is not a tangle file" << std::endl;
+        return false;
+    }
+
+    assert( tn.allTx.empty() );
+
+    //Txs keep pointers into actors, so it is only resized here
+    if( actors.size() < issuerCount )
+    {
+        actors.resize( issuerCount );
+    }
+
+    std::vector<t_ptrTx> byIndex;
+    byIndex.reserve( count + 1 );
+    byIndex.push_back( tn.giveGenBlock() );
+
+    std::map<int, t_ptrTx> unusedTips;
+
+    for( uint64_t i = 0; i < count; ++i )
+    {
+        double timeStamp;
+        uint32_t issuer;
+        uint8_t approvedCount;
+
+        in.read( reinterpret_cast<char*>( &timeStamp ), sizeof( timeStamp ) );
+        in.read( reinterpret_cast<char*>( &issuer ), sizeof( issuer ) );
+        in.read( reinterpret_cast<char*>( &approvedCount ), sizeof( approvedCount ) );
+
+        t_txApproved chosen;
+
+        if( approvedCount > APPROVE_VAL )
+        {
+            std::cerr << filename << ": transaction " << i << " approves " << int( approvedCount ) << " transactions, this build supports "
+                      << APPROVE_VAL << " (TANGLE_APPROVE_VAL)" << std::endl;
+            return false;
+        }
+
+        for( int j = 0; j < approvedCount; ++j )
+        {
+            int64_t approvedIndex;
+            in.read( reinterpret_cast<char*>( &approvedIndex ), sizeof( approvedIndex ) );
+
+            if( approvedIndex < 0 || approvedIndex >= byIndex.size() )
+            {
+                std::cerr << filename << ": transaction " << i << " approves an unknown transaction" << std::endl;
+                return false;
+            }
+
+            chosen.push_back( byIndex[approvedIndex] );
+        }
+
+        if( !in )
+        {
+            std::cerr << filename << ": truncated after " << i << " transactions" << std::endl;
+            return false;
+        }
+
+        if( issuer >= actors.size() )
+        {
+            std::cerr << filename << ": transaction " << i << " has an unknown issuer" << std::endl;
+            return false;
+        }
+
+        TxActor& actor = actors[issuer];
+
+        if( actor.getTanglePtr() == nullptr )
+        {
+            actor.setTanglePtr( &tn );
+        }
+
+        actor.attach( unusedTips, timeStamp, chosen );
+        byIndex.push_back( tn.allTx.back() );
+    }
+
+    return true;
+}
+
+//Tangle file def END
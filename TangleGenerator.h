@@ -0,0 +1,69 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Tangle.h"
+
+// Builds a tangle directly from the pure c++ classes without going through the omnet++ event loop.
+// Arrivals are a Poisson process, each arrival selects tips from the tangle as it is at its issue time and
+// is attached powDelay later with its issue time as timestamp - the same as TxActorModule does with tipTime
+class TangleGenerator
+{
+
+    public:
+        struct Params
+        {
+            long txCount = 0;
+            double arrivalRate = 1.0; // transactions per second across all actors
+            double powDelay = 0.1; // time between tip selection and the transaction appearing in the tangle
+            int actorCount = 1;
+            TipSelectionMethod method = TipSelectionMethod::URTS;
+            double alphaVal = 0.5;
+            int walkDepth = 0;
+            int kMultiplier = 1;
+            bool indexedWalkStart = false;
+            uint64_t seed = 0;
+        };
+
+        TangleGenerator( Tangle& tn, const Params& params );
+
+        // Runs the arrival process until txCount transactions have been attached, returns how many were attached
+        long generate();
+
+        // Weight cache counters summed over the generator's transactors
+        long getWeightCacheHits() const;
+        long getWeightCacheMisses() const;
+
+    private:
+        struct PendingTx
+        {
+            double attachAt;
+            double issueTime;
+            int actor;
+            t_txApproved chosen;
+        };
+
+        Tangle& m_tangle;
+        Params m_params;
+
+        // Owns the transactors so every generated Tx has a valid m_issuedBy
+        std::vector<TxActor> m_actors;
+
+        // Transactions whose POW has not completed yet, attach times are non decreasing so this is a FIFO
+        std::deque<PendingTx> m_pending;
+
+        t_txApproved selectTips( TxActor& actor, double issueTime );
+
+        // Attaches every pending transaction with attachAt <= now
+        void flushPending( double now );
+
+};
+
+// Writes the tangle in attach order so it can be rebuilt with readTangleFile, returns false on I/O failure
+bool writeTangleFile( const Tangle& tn, const std::string& filename );
+
+// Rebuilds a tangle written by writeTangleFile into tn, which must only contain its genesis block.
+// Transactions are re-attached through TxActor::attach by the transactor at the matching index in actors,
+// actors is grown to fit the issuers in the file and must not be resized again while tn is in use
+bool readTangleFile( Tangle& tn, std::vector<TxActor>& actors, const std::string& filename );
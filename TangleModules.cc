@@ -2,8 +2,17 @@
 #include <stdio.h>
 #include <omnetpp.h>
 #include "Tangle.h"
+#include "TangleEngine.h"
+#include "TangleGenerator.h"
+#include "TangleSnapshot.h"
+#include "TangleTrace.h"
+#include "TangleWorkers.h"
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <unordered_map>
 
 using namespace omnetpp;
 
@@ -12,6 +21,10 @@ enum MessageType { NEXT_TX_TIMER, POW_TIMER, TIP_REQUEST, ATTACH_CONFIRM };
 std::ofstream tipData;
 std::ofstream blockWeightData;
 std::ofstream tipAgeData;
+std::ofstream tipStatsData;
+
+// set from TangleModule's recordRawTipData, when false only the streaming statistics are written
+bool recordRawTipData = true;
 
 std::stringstream tipDataStream;
 std::stringstream tipAgeDataStream;
@@ -21,6 +34,124 @@ std::vector<std::stringstream*> blockWeightDataStreams;
 
 std::vector<t_ptrTx> tracker;
 
+// CSR copy of the tangle for the weight snapshots and end of run analytics, brought up to date before each use
+TangleSnapshot tangleSnapshot;
+
+// Runs the tip selections of actors with asyncTipSelection, sized by TangleModule's selectionThreads and
+// maxSelectionsInFlight and started on the first selection. The selections read the tangle without locking,
+// so every event that changes the tangle calls waitForSelections() first
+std::unique_ptr<TangleWorkerPool> selectionPool;
+int selectionThreads = 0;
+int maxSelectionsInFlight = 0;
+
+TangleWorkerPool& giveSelectionPool()
+{
+
+    if( !selectionPool )
+    {
+        selectionPool.reset( new TangleWorkerPool( selectionThreads, maxSelectionsInFlight ) );
+    }
+
+    return *selectionPool;
+
+}
+
+void waitForSelections()
+{
+
+    if( selectionPool )
+    {
+        selectionPool->wait();
+    }
+
+}
+
+
+// 64 bit seed for a TangleRng from two draws of an OMNeT++ RNG stream, so runs repeat with the configured seed
+uint64_t seedFromRng( cRNG* rng )
+{
+    uint64_t high = rng->intRand();
+    return ( high << 32 ) | rng->intRand();
+}
+
+// Keeps tn's transactions in the memory mapped file named by module's txStorageFilename, if set
+void configureTxStorage( cSimpleModule* module, Tangle& tn )
+{
+
+    std::string filename = module->par( "txStorageFilename" ).stdstringValue();
+
+    if( filename.empty() )
+    {
+        return;
+    }
+
+    if( !tn.setStorage( filename, module->par( "residentTx" ).intValue() ) )
+    {
+        throw cRuntimeError( "%s: cannot create transaction storage file %s", module->getFullPath().c_str(), filename.c_str() );
+    }
+
+}
+
+// Appends the tipData row for the transaction self just attached and, if recordWeights, updates the tracked
+// weight snapshots - shared by every module that attaches transactions
+void recordAttachData( TxActor& self, int tipsSeen, bool recordWeights )
+{
+
+    //log data for new tx in .txt file
+    std::string data;
+    data.reserve(100);
+
+    //tx Number
+    data.append(std::to_string(self.getMyTx().back()->TxNumber));
+    data.push_back(',');
+
+    //tip count before
+    data.append( std::to_string(tipsSeen) );
+    data.push_back(',');
+
+    //tip count after
+    data.append( std::to_string(self.getTanglePtr()->getTipNumber()) );
+    data.push_back('\n');
+
+    data.shrink_to_fit();
+
+    if( recordRawTipData )
+    {
+        tipDataStream << data;
+    }
+
+    if( recordWeights )
+    {
+        // Track 10% of transactions
+        if( self.getMyTx().back()->TxNumber % 10 == 0 )
+        {
+            tracker.push_back( self.getMyTx().back() );
+        }
+
+        //append weights of transactions to data file to track how they change
+        if( self.getMyTx().back()->TxNumber % 100 == 0 )
+        {
+
+
+            if( tracker.size() != 0 )
+            {
+                tangleSnapshot.update( *self.getTanglePtr() );
+
+                std::stringstream* pCurrentBlockweightStream = new std::stringstream();
+                for( int i = 0; i < tracker.size(); i++ )
+                {
+
+                    (*pCurrentBlockweightStream) << tracker[i]->TxNumber << "," << tangleSnapshot.computeWeight( tracker[i]->m_tangleIndex, simTime() ) << std::endl;
+
+                }
+
+                blockWeightDataStreams.push_back( pCurrentBlockweightStream );
+            }
+        }
+    }
+
+}
+
 
 /*
  * Classes for Transactors and the tangle network
@@ -35,10 +166,20 @@ private:
     int issueCount;
     TxActor self; // non omnetpp implmentation of transactor
     simtime_t powTime;
+    TipSelectionMethod tipSelectionMethod;
+
+    // Set by asyncTipSelection - selection is queued on the selection pool when the tips arrive and the
+    // result is collected from pendingTips when POW completes
+    bool asyncTipSelection;
+    t_txApproved pendingTips;
+
+    // The region parameter, checked against the tangle's regions when the first tips arrive
+    int region;
 
 protected:
     virtual void initialize() override;
     virtual void handleMessage( cMessage * msg ) override;
+    virtual void finish() override;
 
 public:
     std::map<int, t_ptrTx> actorTipView; // tips sent by tangle are stored by transactor till they can approve some
@@ -56,18 +197,152 @@ class TangleModule : public cSimpleModule
     private:
         int txCount;
         int txLimit;
+        int statsInterval;
         Tangle tn;
 
     protected:
         virtual void initialize() override;
         virtual void handleMessage( cMessage * msg ) override;
 
+    public:
+        // Lets modules that do not go through tip requests attach to this tangle directly
+        Tangle* getTangle();
+
 };
 
 
 Define_Module( TangleModule );
 
 
+// Simulates actorNumber transactors in one module. Each logical actor follows the TxActorModule cycle of
+// request tips -> view arrives -> POW -> attach -> wait txGenRate, but the cycles are merged into one internal
+// event queue driven by a single self message, and the only messages sent are the attach confirmations
+class TxActorPopulationModule : public cSimpleModule
+{
+
+    private:
+        enum Phase { REQUEST_TIPS, VIEW_ARRIVES, POW_DONE, TRACE_ARRIVAL };
+
+        struct ActorEvent
+        {
+            simtime_t time;
+            long seq; // breaks ties in scheduling order, as omnet++ would
+            int actor;
+            Phase phase;
+
+            bool operator>( const ActorEvent& other ) const
+            {
+                return time > other.time || ( time == other.time && seq > other.seq );
+            }
+        };
+
+        // Per actor state as parallel arrays indexed by actor number, a few dozen bytes per actor
+        int actorNumber;
+        std::vector<uint8_t> actorRegion;
+        std::vector<TangleRng::State> actorRng; // each actor's own tip selection generator
+        std::vector<simtime_t> actorIssueTime; // when the actor's next transaction is issued, or its one in flight was
+        std::vector<uint8_t> actorInFlight; // set from issuing a transaction until it is attached
+        std::vector<simtime_t> actorPowTime; // drawn once per actor, like TxActorModule::powTime
+        std::vector<simtime_t> actorTipTime;
+        std::vector<int> actorViewSlot; // index into viewPool while the actor is doing POW, -1 otherwise
+
+        // Runs tip view filtering, tip selection and attach for whichever actor is due, loaded with that actor's
+        // region and generator state first. Transactions it attaches have it as their m_issuedBy
+        TxActor selector;
+        void loadSelector( int actor );
+        void issue( int actor, simtime_t time );
+
+        // Tip views are only held between a view arriving and POW completing, so they are pooled
+        std::vector<std::map<int, t_ptrTx>> viewPool;
+        std::vector<int> freeViewSlots;
+
+        std::priority_queue<ActorEvent, std::vector<ActorEvent>, std::greater<ActorEvent>> events;
+        long eventSeq = 0;
+        cMessage * wakeup = nullptr;
+        bool draining = false; // set while handleMessage runs due events, the wakeup is rescheduled once afterwards
+
+        // An arrival waiting for its issuer to finish the transaction before it
+        struct QueuedArrival
+        {
+            simtime_t issueTime;
+            simtime_t powTime;
+        };
+
+        // Set by arrivalTrace - arrivals and POW durations are replayed from the trace instead of drawn from txGenRate
+        // and powTime. Only the next record is held, as a TRACE_ARRIVAL event. An issuer still busy with its last
+        // transaction when another arrives queues the new one in traceBacklog, up to traceBacklogLimit deep
+        bool replayingTrace = false;
+        TraceReader trace;
+        TraceRecord nextArrival;
+        std::unordered_map<int, std::queue<QueuedArrival>> traceBacklog;
+        int traceBacklogLimit;
+
+        // How far replay fell behind the trace - queued arrivals start late by the time they waited
+        long delayedArrivals = 0;
+        long droppedArrivals = 0;
+        std::size_t deepestBacklog = 0;
+        simtime_t totalArrivalDelay;
+        simtime_t maxArrivalDelay;
+
+        // The actors are split into equal consecutive blocks, one per region of the tangle's visibility layer. Done on
+        // the first event, the TangleModule may be initialised after this module
+        bool regionsAssigned = false;
+
+        Tangle* tangle = nullptr;
+        simtime_t linkDelay;
+        TipSelectionMethod tipSelectionMethod;
+        double walkAlphaValue;
+        int walkDepth;
+        int kMultiplier;
+        bool recordWeights;
+
+        void scheduleActor( int actor, Phase phase, simtime_t time );
+        void handleActorEvent( const ActorEvent& event );
+
+        // Reads the next trace record and schedules its TRACE_ARRIVAL, nothing at the end of the trace
+        void scheduleNextArrival();
+        void handleArrival();
+
+    protected:
+        virtual void initialize() override;
+        virtual void handleMessage( cMessage * msg ) override;
+        virtual void finish() override;
+
+    public:
+        virtual ~TxActorPopulationModule();
+
+};
+
+
+Define_Module( TxActorPopulationModule );
+
+
+// Builds a tangle offline in initialize() with TangleGenerator and writes it to file, no events are scheduled
+class TangleGeneratorModule : public cSimpleModule
+{
+
+    protected:
+        virtual void initialize() override;
+
+};
+
+
+Define_Module( TangleGeneratorModule );
+
+
+// Runs every transactor as a coroutine in ActorEngine inside initialize(), then writes the tangle to file
+class TangleEngineModule : public cSimpleModule
+{
+
+    protected:
+        virtual void initialize() override;
+
+};
+
+
+Define_Module( TangleEngineModule );
+
+
 void TxActorModule::initialize()
 {
 
@@ -75,6 +350,11 @@ void TxActorModule::initialize()
     scheduleAt( simTime() + par( "txGenRate" ), timer );
     EV_DEBUG << "Starting next transaction procedure" << std::endl;
     powTime = par( "powTime" );
+    self.setIndexedWalkStart( par( "indexedWalkStart" ) );
+    tipSelectionMethod = tipSelectionMethodFromString( par( "tipSelectionMethod" ).stdstringValue() );
+    asyncTipSelection = par( "asyncTipSelection" );
+    self.seedRandGen( seedFromRng( getRNG( 0 ) ) );
+    region = par( "region" );
 
 }
 
@@ -104,36 +384,24 @@ void TxActorModule::handleMessage(cMessage * msg)
 
             EV_DEBUG << "Tips seen before starting POW: " << actorTipView.size() << std::endl;
 
-            if( strcmp( par( "tipSelectionMethod" ), "URTS" ) == 0 )
-            {
-
-                t_txApproved chosenTips = self.URTipSelection( actorTipView );
-                self.attach( actorTipView, tipTime, chosenTips);
+            t_txApproved chosenTips;
 
+            if( !asyncTipSelection )
+            {
+                chosenTips = self.selectTips( tipSelectionMethod, actorTipView, tipTime, par( "walkAlphaValue" ), par( "walkDepth" ), par( "k_Multiplier" ) );
             }
-            else if ( strcmp( par( "tipSelectionMethod" ), "WALK" ) == 0  )
-            { //WALK
-
-                t_txApproved chosenTips;
 
-                for(int i = 0; i < APPROVE_VAL; ++i)
-                {
-                    //get start point for each walk
-                    t_ptrTx walkStart = self.getWalkStart( actorTipView, par( "walkDepth" ) );
-                    EV_DEBUG << "Backtrack TX ID: " << walkStart->TxNumber << " found Tx: " << walkStart << " with weight: " << self.ComputeWeight( walkStart, simTime() ) << std::endl;
-
-                    //find a tip
-                    chosenTips.push_back( self.EasyWalkTipSelection( walkStart, par( "walkAlphaValue" ), actorTipView, tipTime ) );
-                }
+            //attach mutates the tangle the pool threads read, so every selection in progress has to finish first. Selections
+            //therefore only overlap the events in between that do not attach. Once the pool is idle pendingTips holds ours
+            waitForSelections();
 
-                self.attach( actorTipView, tipTime, chosenTips );
-            }
-            else // KWALK
+            if( asyncTipSelection )
             {
-                t_txApproved chosenTips = self.NKWalkTipSelection( par( "walkAlphaValue" ), actorTipView, tipTime, par( "k_Multiplier" ), par( "walkDepth" ) );
-                self.attach( actorTipView, tipTime, chosenTips );
+                chosenTips = pendingTips;
             }
 
+            self.attach( actorTipView, tipTime, chosenTips );
+
 
             EV_DEBUG << "Actual tips after: " << self.getTanglePtr()->giveTips().size() << std::endl;
 
@@ -153,67 +421,55 @@ void TxActorModule::handleMessage(cMessage * msg)
             attachConfirm->setContextPointer( self.getMyTx().back() );
             send( attachConfirm, "tangleConnect$o" );
 
-            //log data for new tx in .txt file
-            std::string data;
-            data.reserve(100);
+            recordAttachData( self, actorTipView.size(), par( "recordWeights" ) );
 
-            //tx Number
-            data.append(std::to_string(self.getMyTx().back()->TxNumber));
-            data.push_back(',');
+        }
 
-            //tip count before
-            data.append( std::to_string(actorTipView.size()) );
-            data.push_back(',');
+    } else
+    { //TIP MESSAGE FROM TANGLE
 
-            //tip count after
-            data.append( std::to_string(self.getTanglePtr()->getTipNumber()) );
-            data.push_back('\n');
+            // give the transactors a pointer to the tangle they're interacting with
+            if( self.getTanglePtr() == nullptr )
+            {
+                self.setTanglePtr( ( Tangle *) msg->getContextPointer() );
 
-            data.shrink_to_fit();
-            tipDataStream << data;
+                const TangleVisibility& visibility = self.getTanglePtr()->visibility;
 
-            if( par("recordWeights") )
-            {
-                // Track 10% of transactions
-                if( self.getMyTx().back()->TxNumber % 10 == 0 )
+                //checked before it goes into the one byte region of TxActor
+                if( region < 0 || ( visibility.isEnabled() && region >= visibility.getRegionCount() ) )
                 {
-                    tracker.push_back( self.getMyTx().back() );
+                    throw cRuntimeError( "TxActorModule: region %d but the tangle has %d regions", region, visibility.getRegionCount() );
                 }
 
-                //append weights of transactions to data file to track how they change
-                if( self.getMyTx().back()->TxNumber % 100 == 0 )
-                {
-
-
-                    if( tracker.size() != 0 )
-                    {
-                        std::stringstream* pCurrentBlockweightStream = new std::stringstream();
-                        for( int i = 0; i < tracker.size(); i++ )
-                        {
-
-                            (*pCurrentBlockweightStream) << tracker[i]->TxNumber << "," << self.ComputeWeight( tracker[i], simTime() ) << std::endl;
-
-                        }
-
-                        blockWeightDataStreams.push_back( pCurrentBlockweightStream );
-                    }
-                }
+                self.setRegion( visibility.isEnabled() ? region : 0 );
             }
 
-        }
-
-    } else
-    { //TIP MESSAGE FROM TANGLE
-
-            // give the transactors a pointer to the tangle they're interacting with
-            if( self.getTanglePtr() == nullptr )
+            //get copy of current tips, minus any the expiry policy drops now
+            if( self.getTanglePtr()->getTipExpiry() > 0 )
             {
-                self.setTanglePtr( ( Tangle *) msg->getContextPointer() );
+                waitForSelections();
+                self.getTanglePtr()->expireTips( simTime() );
             }
 
-            //get copy of current tips
             actorTipView = self.getTanglePtr()->giveTips();
             tipTime = simTime();
+            self.filterTipView( actorTipView, tipTime );
+
+            if( asyncTipSelection )
+            {
+                //the view and its time are fixed from here on. No other event changes the tangle until this
+                //selection has finished, so it sees the tangle as it is now whichever thread runs it
+                TipSelectionMethod method = tipSelectionMethod;
+                double alphaVal = par( "walkAlphaValue" );
+                int walkDepth = par( "walkDepth" );
+                int kMultiplier = par( "k_Multiplier" );
+
+                giveSelectionPool().submit( [this, method, alphaVal, walkDepth, kMultiplier]()
+                    {
+                        pendingTips = self.selectTips( method, actorTipView, tipTime, alphaVal, walkDepth, kMultiplier );
+                    }
+                );
+            }
 
             //start timer for when POW is completed
             cMessage * powTimer = new cMessage( "powTimer", POW_TIMER );
@@ -224,10 +480,31 @@ void TxActorModule::handleMessage(cMessage * msg)
 
 }
 
+void TxActorModule::finish()
+{
+
+    //a selection still running would outlive this module when the run ends on a time limit
+    waitForSelections();
+
+    long lookups = self.getWeightCacheHits() + self.getWeightCacheMisses();
+
+    recordScalar( "weightCacheHits", self.getWeightCacheHits() );
+    recordScalar( "weightCacheMisses", self.getWeightCacheMisses() );
+    recordScalar( "weightCacheHitRate", lookups > 0 ? double( self.getWeightCacheHits() ) / lookups : 0.0 );
+
+}
+
 void TangleModule::initialize()
 
 {
     tracker.clear();
+    tangleSnapshot = TangleSnapshot();
+    tangleSnapshot.setWeightThreads( par( "weightThreads" ), par( "parallelWeightThreshold" ) );
+
+    //a pool left from an earlier run is idle, its threads are replaced by ones sized for this run
+    selectionPool.reset();
+    selectionThreads = par( "selectionThreads" );
+    maxSelectionsInFlight = par( "maxSelectionsInFlight" );
     txCount = 0;
     txLimit = par( "transactionLimit" );
     Tx::tx_totalCount = 0;
@@ -238,12 +515,35 @@ void TangleModule::initialize()
 
     std::string filename2 = par("tipAgeFilename");
     tipAgeData.open(filename2.c_str(), std::ios::app);
-    tipAgeData << "TxNumber," << "Tip Age," << "First Approval Time," << "Attach Time," << "Direct Approvers" << std::endl;
+    tipAgeData << "TxNumber," << "Tip Age," << "First Approval Time," << "Attach Time," << "Direct Approvers," << "Orphaned" << std::endl;
 
     std::string filename3 = par("blockWeightFilename");
     blockWeightData.open(filename3.c_str(), std::ios::app);
     blockWeightData << "TxNumber," << "Weight" << std::endl;
 
+    recordRawTipData = par( "recordRawTipData" );
+    statsInterval = par( "statsInterval" );
+
+    tn.getRandGen().seed( seedFromRng( getRNG( 0 ) ) );
+    tn.setTipExpiry( par( "tipExpiry" ) );
+
+    if( !tn.visibility.configure( par( "regionDelays" ).stdstringValue() ) )
+    {
+        throw cRuntimeError( "TangleModule: regionDelays is not a square matrix of at most 256 non negative delays" );
+    }
+
+    configureTxStorage( this, tn );
+    tn.stats.configure( par( "tipAgeBinWidth" ).doubleValue(), par( "tipCountBinWidth" ).doubleValue(), par( "statsBinCount" ), par( "statsWindow" ) );
+
+    std::string filename4 = par("tipStatsFilename");
+    tipStatsData.open(filename4.c_str(), std::ios::app);
+    TangleStats::writeHeader( tipStatsData );
+
+}
+
+Tangle* TangleModule::getTangle()
+{
+    return &tn;
 }
 
 void TangleModule::handleMessage( cMessage * msg )
@@ -279,17 +579,34 @@ void TangleModule::handleMessage( cMessage * msg )
         {
 
             EV_DEBUG << "Transaction Limit reached, stopping simulation" << std::endl;
+            waitForSelections();
+            recordScalar( "orphanedTips", tn.getOrphanCount() );
+
+            if( selectionPool )
+            {
+                recordScalar( "peakSelectionsInFlight", selectionPool->getPeakUnfinished() );
+            }
+
+            recordScalar( "evictedTxChunks", tn.getEvictedChunks() );
             delete msg;
 
             // write out data files before cleaning up
 
+            tn.stats.write( tipStatsData, justAttached->TxNumber, true );
+
             //record time from attach to first approval
             double tipAge;
 
-            for(int i = 0; i < tn.allTx.size(); i++)
+            if( recordRawTipData )
+            {
+                tangleSnapshot.update( tn );
+            }
+
+            //row 0 is the genesis block, which is not in allTx
+            for(long i = 1; recordRawTipData && i < tangleSnapshot.size(); i++)
             {
-                tipAge = tn.allTx[i]->firstApprovedTime.dbl() - tn.allTx[i]->timeStamp.dbl();
-                tipAgeDataStream << tn.allTx[i]->TxNumber << "," << tipAge << "," << tn.allTx[i]->firstApprovedTime.dbl() << "," << tn.allTx[i]->timeStamp.dbl() << "," << tn.allTx[i]->m_approvedBy.size() << std::endl;
+                tipAge = tangleSnapshot.firstApprovedTime[i] - tangleSnapshot.timeStamp[i];
+                tipAgeDataStream << tangleSnapshot.txNumber[i] << "," << tipAge << "," << tangleSnapshot.firstApprovedTime[i] << "," << tangleSnapshot.timeStamp[i] << "," << tangleSnapshot.approverCount( i ) << "," << int( tangleSnapshot.orphaned[i] ) << std::endl;
             }
 
             // Write out the data in one go
@@ -313,7 +630,7 @@ void TangleModule::handleMessage( cMessage * msg )
 
             for( auto tx : tn.allTx)
             {
-                delete tx;
+                tn.destroyTx( tx );
             }
 
             if( blockWeightDataStreams.size() > 0 )
@@ -325,10 +642,12 @@ void TangleModule::handleMessage( cMessage * msg )
             }
 
             blockWeightDataStreams.clear();
+            tangleSnapshot = TangleSnapshot();
 
             tipData.close();
             blockWeightData.close();
             tipAgeData.close();
+            tipStatsData.close();
 
 
             endSimulation();
@@ -338,6 +657,12 @@ void TangleModule::handleMessage( cMessage * msg )
         {
 
             EV_DEBUG << "Total Transactions now: " << justAttached->TxNumber << std::endl;
+
+            if( statsInterval > 0 && justAttached->TxNumber % statsInterval == 0 )
+            {
+                tn.stats.write( tipStatsData, justAttached->TxNumber, false );
+            }
+
             delete msg;
 
         }
@@ -346,6 +671,443 @@ void TangleModule::handleMessage( cMessage * msg )
 
 }
 
+void TangleGeneratorModule::initialize()
+{
+
+    //genesis block is numbered 0, same as a fresh TangleModule run
+    Tx::tx_totalCount = 0;
+    Tangle tn;
+
+    TangleGenerator::Params params;
+    params.txCount = par( "transactionLimit" ).intValue();
+    params.arrivalRate = par( "arrivalRate" );
+    params.powDelay = par( "powTime" );
+    params.actorCount = par( "txActorNumber" );
+    params.method = tipSelectionMethodFromString( par( "tipSelectionMethod" ).stdstringValue() );
+    params.alphaVal = par( "walkAlphaValue" );
+    params.walkDepth = par( "walkDepth" );
+    params.kMultiplier = par( "k_Multiplier" );
+    params.indexedWalkStart = par( "indexedWalkStart" );
+    params.seed = seedFromRng( getRNG( 0 ) );
+    tn.setTipExpiry( par( "tipExpiry" ) );
+    configureTxStorage( this, tn );
+
+    TangleGenerator generator( tn, params );
+
+    auto start = std::chrono::steady_clock::now();
+    long generated = generator.generate();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EV_INFO << "Generated " << generated << " transactions in " << elapsed.count() << "s ("
+            << generated / elapsed.count() << " tx/s), " << tn.getTipNumber() << " tips remaining" << std::endl;
+
+    recordScalar( "weightCacheHits", generator.getWeightCacheHits() );
+    recordScalar( "weightCacheMisses", generator.getWeightCacheMisses() );
+    recordScalar( "orphanedTips", tn.getOrphanCount() );
+    recordScalar( "evictedTxChunks", tn.getEvictedChunks() );
+
+    std::string filename = par( "tangleFilename" );
+
+    if( !writeTangleFile( tn, filename ) )
+    {
+        EV_WARN << "Failed to write generated tangle to " << filename << std::endl;
+    }
+
+    for( auto tx : tn.allTx )
+    {
+        tn.destroyTx( tx );
+    }
+
+    tn.destroyTx( tn.giveGenBlock() );
+
+}
+
+void TxActorPopulationModule::initialize()
+{
+
+    TangleModule* tangleModule = dynamic_cast<TangleModule*>( getParentModule()->getSubmodule( par( "tangleModule" ) ) );
+
+    if( tangleModule == nullptr )
+    {
+        throw cRuntimeError( "TxActorPopulationModule: no TangleModule named %s", par( "tangleModule" ).stringValue() );
+    }
+
+    actorNumber = par( "actorNumber" );
+    tangle = tangleModule->getTangle();
+    linkDelay = par( "linkDelay" );
+    tipSelectionMethod = tipSelectionMethodFromString( par( "tipSelectionMethod" ).stdstringValue() );
+    walkAlphaValue = par( "walkAlphaValue" );
+    walkDepth = par( "walkDepth" );
+    kMultiplier = par( "k_Multiplier" );
+    recordWeights = par( "recordWeights" );
+
+    actorRegion.assign( actorNumber, 0 );
+    actorRng.resize( actorNumber );
+    actorIssueTime.resize( actorNumber );
+    actorInFlight.assign( actorNumber, 0 );
+    actorPowTime.resize( actorNumber );
+    actorTipTime.resize( actorNumber );
+    actorViewSlot.assign( actorNumber, -1 );
+
+    selector.setTanglePtr( tangle );
+    selector.setIndexedWalkStart( par( "indexedWalkStart" ) );
+    selector.seedRandGen( 0 );
+
+    std::string traceFilename = par( "arrivalTrace" );
+    replayingTrace = !traceFilename.empty();
+    traceBacklogLimit = par( "traceBacklogLimit" );
+
+    if( traceBacklogLimit < 0 )
+    {
+        throw cRuntimeError( "TxActorPopulationModule: traceBacklogLimit %d is negative", traceBacklogLimit );
+    }
+
+    if( replayingTrace && !trace.open( traceFilename ) )
+    {
+        throw cRuntimeError( "TxActorPopulationModule: %s", trace.getError().c_str() );
+    }
+
+    for( int i = 0; i < actorNumber; ++i )
+    {
+        actorRng[i] = TangleRng( seedFromRng( getRNG( 0 ) ) ).getState();
+
+        if( !replayingTrace )
+        {
+            actorPowTime[i] = par( "powTime" );
+            issue( i, simTime() + par( "txGenRate" ) );
+        }
+    }
+
+    if( replayingTrace )
+    {
+        scheduleNextArrival();
+    }
+
+    EV_DEBUG << "Started " << actorNumber << " transactors" << std::endl;
+
+}
+
+void TxActorPopulationModule::scheduleActor( int actor, Phase phase, simtime_t time )
+{
+
+    events.push( { time, eventSeq++, actor, phase } );
+
+    //keep the single self message pointing at the earliest actor event
+    if( wakeup == nullptr )
+    {
+        wakeup = new cMessage( "populationWakeup", NEXT_TX_TIMER );
+    }
+
+    if( draining )
+    {
+        return;
+    }
+
+    if( !wakeup->isScheduled() || events.top().time < wakeup->getArrivalTime() )
+    {
+        cancelEvent( wakeup );
+        scheduleAt( events.top().time, wakeup );
+    }
+
+}
+
+void TxActorPopulationModule::issue( int actor, simtime_t time )
+{
+    actorIssueTime[actor] = time;
+    scheduleActor( actor, REQUEST_TIPS, time );
+}
+
+void TxActorPopulationModule::loadSelector( int actor )
+{
+    selector.setRegion( actorRegion[actor] );
+    selector.getRandGen().setState( actorRng[actor] );
+}
+
+void TxActorPopulationModule::handleMessage( cMessage * msg )
+{
+
+    //the only message arriving here is our own wakeup
+    if( msg != wakeup )
+    {
+        throw cRuntimeError( "TxActorPopulationModule: unexpected message %s", msg->getName() );
+    }
+
+    if( !regionsAssigned )
+    {
+        int regions = std::max( 1, tangle->visibility.getRegionCount() );
+
+        for( long i = 0; i < actorNumber; ++i )
+        {
+            actorRegion[i] = i * regions / actorNumber;
+        }
+
+        regionsAssigned = true;
+    }
+
+    //run every actor event due now
+    draining = true;
+
+    while( !events.empty() && events.top().time <= simTime() )
+    {
+        ActorEvent event = events.top();
+        events.pop();
+
+        handleActorEvent( event );
+    }
+
+    draining = false;
+
+    if( !events.empty() )
+    {
+        scheduleAt( events.top().time, wakeup );
+    }
+
+}
+
+void TxActorPopulationModule::handleActorEvent( const ActorEvent& event )
+{
+
+    int actor = event.actor;
+
+    if( event.phase == TRACE_ARRIVAL )
+    {
+        handleArrival();
+    }
+    else if( event.phase == REQUEST_TIPS )
+    {
+        //the request travels to the tangle and the tips travel back, as over the TangleSim channels
+        actorInFlight[actor] = 1;
+        scheduleActor( actor, VIEW_ARRIVES, simTime() + 2 * linkDelay );
+    }
+    else if( event.phase == VIEW_ARRIVES )
+    {
+        int slot;
+
+        if( freeViewSlots.empty() )
+        {
+            slot = viewPool.size();
+            viewPool.emplace_back();
+        }
+        else
+        {
+            slot = freeViewSlots.back();
+            freeViewSlots.pop_back();
+        }
+
+        //get copy of current tips, minus any the expiry policy drops now
+        tangle->expireTips( simTime() );
+        viewPool[slot] = tangle->giveTips();
+        actorViewSlot[actor] = slot;
+        actorTipTime[actor] = simTime();
+
+        //filtering draws no random numbers, only the region is needed
+        selector.setRegion( actorRegion[actor] );
+        selector.filterTipView( viewPool[slot], simTime() );
+
+        scheduleActor( actor, POW_DONE, simTime() + actorPowTime[actor] );
+    }
+    else
+    { //POW_DONE
+
+        TxActor& self = selector;
+        std::map<int, t_ptrTx>& actorTipView = viewPool[actorViewSlot[actor]];
+
+        loadSelector( actor );
+        self.forgetMyTx();
+
+        t_txApproved chosenTips = self.selectTips( tipSelectionMethod, actorTipView, actorTipTime[actor], walkAlphaValue, walkDepth, kMultiplier );
+        self.attach( actorTipView, actorTipTime[actor], chosenTips );
+
+        actorRng[actor] = self.getRandGen().getState();
+
+        //start a new issue timer, or when replaying start the issuer's next queued transaction
+        if( !replayingTrace )
+        {
+            actorInFlight[actor] = 0;
+            issue( actor, simTime() + par( "txGenRate" ) );
+        }
+        else if( traceBacklog.count( actor ) > 0 )
+        {
+            std::queue<QueuedArrival>& queued = traceBacklog[actor];
+            QueuedArrival arrival = queued.front();
+            queued.pop();
+
+            if( queued.empty() )
+            {
+                traceBacklog.erase( actor );
+            }
+
+            //the trace had it start at issueTime, it could only start once the issuer was free
+            simtime_t delay = simTime() - arrival.issueTime;
+
+            ++delayedArrivals;
+            totalArrivalDelay += delay;
+            maxArrivalDelay = std::max( maxArrivalDelay, delay );
+
+            actorPowTime[actor] = arrival.powTime;
+            issue( actor, simTime() );
+        }
+        else
+        {
+            actorInFlight[actor] = 0;
+        }
+
+        //Inform tangle of attached Tx
+        cMessage * attachConfirm = new cMessage( "attachConfirmed", ATTACH_CONFIRM );
+        attachConfirm->setContextPointer( self.getMyTx().back() );
+        send( attachConfirm, "tangleConnect$o" );
+
+        recordAttachData( self, actorTipView.size(), recordWeights );
+
+        actorTipView.clear();
+        freeViewSlots.push_back( actorViewSlot[actor] );
+        actorViewSlot[actor] = -1;
+    }
+
+}
+
+void TxActorPopulationModule::finish()
+{
+
+    long hits = selector.getWeightCacheHits();
+    long misses = selector.getWeightCacheMisses();
+
+    recordScalar( "weightCacheHits", hits );
+    recordScalar( "weightCacheMisses", misses );
+    recordScalar( "weightCacheHitRate", hits + misses > 0 ? double( hits ) / ( hits + misses ) : 0.0 );
+
+    if( replayingTrace )
+    {
+        recordScalar( "delayedArrivals", delayedArrivals );
+        recordScalar( "droppedArrivals", droppedArrivals );
+        recordScalar( "deepestTraceBacklog", deepestBacklog );
+        recordScalar( "meanArrivalDelay", delayedArrivals > 0 ? totalArrivalDelay.dbl() / delayedArrivals : 0.0, "s" );
+        recordScalar( "maxArrivalDelay", maxArrivalDelay.dbl(), "s" );
+    }
+
+}
+
+void TxActorPopulationModule::scheduleNextArrival()
+{
+
+    if( !trace.next( nextArrival ) )
+    {
+        if( !trace.getError().empty() )
+        {
+            throw cRuntimeError( "TxActorPopulationModule: %s", trace.getError().c_str() );
+        }
+
+        EV_INFO << "Arrival trace finished after " << trace.getRecordCount() << " records" << std::endl;
+        return;
+    }
+
+    if( nextArrival.issuer >= unsigned( actorNumber ) )
+    {
+        throw cRuntimeError( "TxActorPopulationModule: trace issuer %u but actorNumber is %d", nextArrival.issuer, actorNumber );
+    }
+
+    //records should be in issue time order, any that are not start as soon as they are read
+    simtime_t arrival = nextArrival.issueTime;
+    scheduleActor( -1, TRACE_ARRIVAL, arrival < simTime() ? simTime() : arrival );
+
+}
+
+void TxActorPopulationModule::handleArrival()
+{
+
+    int actor = nextArrival.issuer;
+
+    if( actorInFlight[actor] )
+    {
+        std::queue<QueuedArrival>& queued = traceBacklog[actor];
+
+        //a trace denser than the issuer's POW would otherwise grow the queue without bound
+        if( traceBacklogLimit > 0 && queued.size() >= std::size_t( traceBacklogLimit ) )
+        {
+            if( droppedArrivals == 0 )
+            {
+                EV_WARN << "Issuer " << actor << " has " << queued.size() << " trace arrivals queued, dropping arrivals "
+                        << "beyond traceBacklogLimit - the trace is denser than its POW times allow" << std::endl;
+            }
+
+            ++droppedArrivals;
+        }
+        else
+        {
+            queued.push( { nextArrival.issueTime, nextArrival.powTime } );
+            deepestBacklog = std::max( deepestBacklog, queued.size() );
+        }
+    }
+    else
+    {
+        //in flight from now, an arrival right behind it must queue rather than start a second transaction
+        actorInFlight[actor] = 1;
+        actorPowTime[actor] = nextArrival.powTime;
+
+        issue( actor, simTime() );
+    }
+
+    scheduleNextArrival();
+
+}
+
+TxActorPopulationModule::~TxActorPopulationModule()
+{
+    cancelAndDelete( wakeup );
+}
 
+void TangleEngineModule::initialize()
+{
 
+#ifdef TANGLE_HAS_COROUTINES
+    //genesis block is numbered 0, same as a fresh TangleModule run
+    Tx::tx_totalCount = 0;
+    Tangle tn;
+
+    ActorEngine::Params params;
+    params.txCount = par( "transactionLimit" ).intValue();
+    params.actorCount = par( "txActorNumber" );
+    params.meanTxGenTime = par( "txGenRate" );
+    params.powTime = par( "powTime" );
+    params.linkDelay = par( "linkDelay" );
+    params.method = tipSelectionMethodFromString( par( "tipSelectionMethod" ).stdstringValue() );
+    params.alphaVal = par( "walkAlphaValue" );
+    params.walkDepth = par( "walkDepth" );
+    params.kMultiplier = par( "k_Multiplier" );
+    params.indexedWalkStart = par( "indexedWalkStart" );
+    params.seed = seedFromRng( getRNG( 0 ) );
+    tn.setTipExpiry( par( "tipExpiry" ) );
+    configureTxStorage( this, tn );
+
+    ActorEngine engine( tn, params );
+
+    auto start = std::chrono::steady_clock::now();
+    long attached = engine.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EV_INFO << "Attached " << attached << " transactions from " << params.actorCount << " transactors in " << elapsed.count() << "s, "
+            << engine.getEventCount() << " events, simulated time " << engine.now() << "s" << std::endl;
+
+    recordScalar( "engineEvents", engine.getEventCount() );
+    recordScalar( "engineWallTime", elapsed.count() );
+    recordScalar( "orphanedTips", tn.getOrphanCount() );
+    recordScalar( "evictedTxChunks", tn.getEvictedChunks() );
+
+    std::string filename = par( "tangleFilename" );
+
+    if( !writeTangleFile( tn, filename ) )
+    {
+        EV_WARN << "Failed to write tangle to " << filename << std::endl;
+    }
 
+    for( auto tx : tn.allTx )
+    {
+        tn.destroyTx( tx );
+    }
+
+    tn.destroyTx( tn.giveGenBlock() );
+#else
+    throw cRuntimeError( "TangleEngineModule needs the simulation built with C++20 coroutine support" );
+#endif
+
+}
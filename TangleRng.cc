@@ -0,0 +1,97 @@
+#include "TangleRng.h"
+
+namespace
+{
+    uint64_t rotl( uint64_t x, int k )
+    {
+        return ( x << k ) | ( x >> ( 64 - k ) );
+    }
+}
+
+/*
+    TANGLERNG DEFINITIONS
+*/
+
+TangleRng::TangleRng( uint64_t seed )
+{
+    this->seed( seed );
+}
+
+void TangleRng::seed( uint64_t seed )
+{
+
+    //splitmix64, so similar seeds still give unrelated states and the state is never all zero
+    for( auto& word : m_state )
+    {
+        uint64_t z = ( seed += 0x9e3779b97f4a7c15 );
+        z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9;
+        z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111eb;
+        word = z ^ ( z >> 31 );
+    }
+
+    m_next = BLOCK;
+
+}
+
+void TangleRng::refill()
+{
+
+    m_blockState = m_state;
+
+    uint64_t s0 = m_state[0];
+    uint64_t s1 = m_state[1];
+    uint64_t s2 = m_state[2];
+    uint64_t s3 = m_state[3];
+
+    for( int i = 0; i < BLOCK; ++i )
+    {
+        m_block[i] = rotl( s1 * 5, 7 ) * 9;
+        step( s0, s1, s2, s3 );
+    }
+
+    m_state = { s0, s1, s2, s3 };
+    m_next = 0;
+
+}
+
+void TangleRng::step( uint64_t& s0, uint64_t& s1, uint64_t& s2, uint64_t& s3 )
+{
+
+    uint64_t t = s1 << 17;
+
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = rotl( s3, 45 );
+
+}
+
+TangleRng::State TangleRng::getState() const
+{
+
+    if( m_next == BLOCK )
+    {
+        return m_state;
+    }
+
+    //replay the block up to the next unused output, the outputs after it are what that state produces
+    State state = m_blockState;
+
+    for( int i = 0; i < m_next; ++i )
+    {
+        step( state[0], state[1], state[2], state[3] );
+    }
+
+    return state;
+
+}
+
+void TangleRng::setState( const State& state )
+{
+    m_state = state;
+    m_next = BLOCK;
+}
+
+//TangleRng def END
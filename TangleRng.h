@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// xoshiro256** generator used for tip selection. Outputs are produced BLOCK at a time so the state update loop
+// runs without interruption, and bounded() maps them to a range without modulo bias (Lemire's method) - cheaper
+// per walk step than std::mt19937 behind a freshly constructed std::uniform_int_distribution.
+// Also a UniformRandomBitGenerator, so std distributions accept it
+class TangleRng
+{
+
+    public:
+        using result_type = uint64_t;
+        using State = std::array<uint64_t, 4>;
+
+        explicit TangleRng( uint64_t seed = 0 );
+
+        // Expands seed into the full state with splitmix64 and discards any buffered outputs
+        void seed( uint64_t seed );
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        result_type operator()() { return next(); }
+
+        uint64_t next()
+        {
+            if( m_next == BLOCK )
+            {
+                refill();
+            }
+
+            return m_block[m_next++];
+        }
+
+        // Uniform in [0, range), range > 0
+        uint32_t bounded( uint32_t range )
+        {
+            uint64_t product = ( next() >> 32 ) * range;
+            uint32_t low = uint32_t( product );
+
+            //only the few values below 2^32 mod range are rejected
+            if( low < range )
+            {
+                uint32_t threshold = uint32_t( -range ) % range;
+
+                while( low < threshold )
+                {
+                    product = ( next() >> 32 ) * range;
+                    low = uint32_t( product );
+                }
+            }
+
+            return uint32_t( product >> 32 );
+        }
+
+        // Uniform in [0, 1) with 53 random bits
+        double uniform()
+        {
+            return ( next() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+        }
+
+        // The state the next output is drawn from. A generator given it with setState continues the sequence
+        // exactly where this one is, so callers can keep many generators as 32 bytes each and run them in one
+        State getState() const;
+        void setState( const State& state );
+
+    private:
+        static const int BLOCK = 16;
+
+        State m_state;
+        State m_blockState; // m_state before the refill that produced m_block
+        std::array<uint64_t, BLOCK> m_block;
+        int m_next = BLOCK;
+
+        void refill();
+        static void step( uint64_t& s0, uint64_t& s1, uint64_t& s2, uint64_t& s3 );
+
+};
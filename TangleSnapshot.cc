@@ -0,0 +1,418 @@
+#include "TangleSnapshot.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // Rows a worker expands from its own stack between updates of the shared outstanding count
+    const int PARALLEL_BATCH = 64;
+
+    // The part of a worker's stack other workers can steal from. The owner works from a private stack and only
+    // moves rows here when some worker is idle, so the lock is rarely taken on the hot path
+    struct StealDeque
+    {
+        std::mutex lock;
+        std::deque<uint32_t> rows;
+    };
+
+    // Refills stack from the worker's own deque, or failing that steals the older half of another worker's
+    bool takeWork( std::vector<StealDeque>& deques, int self, std::vector<uint32_t>& stack )
+    {
+        for( int i = 0; i < deques.size(); ++i )
+        {
+            StealDeque& victim = deques[( self + i ) % deques.size()];
+            std::lock_guard<std::mutex> guard( victim.lock );
+
+            if( victim.rows.empty() )
+            {
+                continue;
+            }
+
+            //the owner takes everything back, thieves take the oldest rows - nearest the query root, so the largest cones
+            size_t take = i == 0 ? victim.rows.size() : ( victim.rows.size() + 1 ) / 2;
+
+            stack.insert( stack.end(), victim.rows.begin(), victim.rows.begin() + take );
+            victim.rows.erase( victim.rows.begin(), victim.rows.begin() + take );
+
+            return true;
+        }
+
+        return false;
+    }
+}
+
+/*
+    TANGLESNAPSHOT DEFINITIONS
+*/
+
+const uint32_t TangleSnapshot::NO_EDGE;
+
+void TangleSnapshot::update( const Tangle& tn )
+{
+
+    if( approvesOffset.empty() )
+    {
+        approvesOffset.push_back( 0 );
+        approvedByOffset.push_back( 0 );
+        appendRow( tn.giveGenBlock() );
+    }
+
+    //tips from the last update may have been approved or orphaned since
+    int stillUnapproved = 0;
+
+    for( int i = 0; i < m_unapproved.size(); ++i )
+    {
+        t_ptrTx tx = m_unapprovedTx[i];
+        orphaned[m_unapproved[i]] = tx->isOrphaned;
+
+        if( tx->isApproved )
+        {
+            firstApprovedTime[m_unapproved[i]] = tx->firstApprovedTime.dbl();
+        }
+        else
+        {
+            m_unapproved[stillUnapproved] = m_unapproved[i];
+            m_unapprovedTx[stillUnapproved] = tx;
+            ++stillUnapproved;
+        }
+    }
+
+    m_unapproved.resize( stillUnapproved );
+    m_unapprovedTx.resize( stillUnapproved );
+
+    //approves never change once attached, so only new rows are needed
+    for( long i = size() - 1; i < tn.allTx.size(); ++i )
+    {
+        appendRow( tn.allTx[i] );
+    }
+
+    //merging costs O( rows + edges ), waiting until the delta is a fixed fraction of the edges keeps it O(1) per edge
+    if( m_deltaApprover.size() * 4 > approvedBy.size() )
+    {
+        rebuildApprovedBy();
+    }
+
+}
+
+void TangleSnapshot::appendRow( t_ptrTx tx )
+{
+
+    assert( tx->m_tangleIndex == size() );
+
+    txNumber.push_back( tx->TxNumber );
+    timeStamp.push_back( tx->timeStamp.dbl() );
+    firstApprovedTime.push_back( tx->firstApprovedTime.dbl() );
+    orphaned.push_back( tx->isOrphaned );
+
+    if( !tx->isApproved )
+    {
+        m_unapproved.push_back( tx->m_tangleIndex );
+        m_unapprovedTx.push_back( tx );
+    }
+
+    //no approved by rows until the next merge, its approvers so far are on the delta lists like any later ones
+    approvedByOffset.push_back( approvedByOffset.back() );
+    m_deltaHead.push_back( NO_EDGE );
+    m_deltaTail.push_back( NO_EDGE );
+
+    for( auto& approved : tx->m_TxApproved )
+    {
+        approves.push_back( approved->m_tangleIndex );
+        addDeltaApprover( approved->m_tangleIndex, tx->m_tangleIndex );
+    }
+
+    approvesOffset.push_back( approves.size() );
+
+}
+
+void TangleSnapshot::addDeltaApprover( uint32_t row, uint32_t approver )
+{
+
+    uint32_t edge = m_deltaApprover.size();
+
+    m_deltaApprover.push_back( approver );
+    m_deltaNext.push_back( NO_EDGE );
+
+    if( m_deltaHead[row] == NO_EDGE )
+    {
+        m_deltaHead[row] = edge;
+    }
+    else
+    {
+        m_deltaNext[m_deltaTail[row]] = edge;
+    }
+
+    m_deltaTail[row] = edge;
+
+}
+
+// Counting sort of the approves rows into approved by rows, emptying the delta lists. Scanning rows in index order
+// keeps each approved by row in attach order, the same order as Tx::m_approvedBy
+void TangleSnapshot::rebuildApprovedBy()
+{
+
+    long rows = size();
+
+    approvedByOffset.assign( rows + 1, 0 );
+
+    for( auto target : approves )
+    {
+        ++approvedByOffset[target + 1];
+    }
+
+    for( long i = 0; i < rows; ++i )
+    {
+        approvedByOffset[i + 1] += approvedByOffset[i];
+    }
+
+    approvedBy.resize( approves.size() );
+    std::vector<uint64_t> fill( approvedByOffset.begin(), approvedByOffset.end() - 1 );
+
+    for( long i = 0; i < rows; ++i )
+    {
+        for( uint64_t e = approvesOffset[i]; e < approvesOffset[i + 1]; ++e )
+        {
+            approvedBy[fill[approves[e]]++] = i;
+        }
+    }
+
+    m_deltaHead.assign( rows, NO_EDGE );
+    m_deltaTail.assign( rows, NO_EDGE );
+    m_deltaApprover.clear();
+    m_deltaNext.clear();
+
+}
+
+long TangleSnapshot::size() const
+{
+    return timeStamp.size();
+}
+
+int TangleSnapshot::approverCount( long index ) const
+{
+    int count = approvedByOffset[index + 1] - approvedByOffset[index];
+
+    for( uint32_t d = m_deltaHead[index]; d != NO_EDGE; d = m_deltaNext[d] )
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+// Iterative version of TxActor::_computeWeight - counts every transaction reached through approvers, expanding
+// only those visible at timeStamp, plus the transaction itself
+int TangleSnapshot::computeWeight( long index, omnetpp::simtime_t timeStamp )
+{
+
+    double viewTime = timeStamp.dbl();
+
+    //rows only approve earlier rows, so everything after index bounds the cone
+    if( m_weightThreads > 1 && size() - index >= m_parallelThreshold )
+    {
+        return computeWeightParallel( index, viewTime );
+    }
+
+    if( m_visitEpoch.size() < size() )
+    {
+        m_visitEpoch.resize( size(), 0 );
+    }
+
+    if( ++m_epoch == 0 )
+    {
+        std::fill( m_visitEpoch.begin(), m_visitEpoch.end(), 0 );
+        m_epoch = 1;
+    }
+
+    int weight = 0;
+
+    m_stack.clear();
+    m_stack.push_back( index );
+    m_visitEpoch[index] = m_epoch;
+
+    while( !m_stack.empty() )
+    {
+        uint32_t current = m_stack.back();
+        m_stack.pop_back();
+
+        if( this->timeStamp[current] > viewTime )
+        {
+            continue;
+        }
+
+        forEachApprover( current, [this, &weight]( uint32_t approver )
+            {
+                if( m_visitEpoch[approver] != m_epoch )
+                {
+                    m_visitEpoch[approver] = m_epoch;
+                    ++weight;
+                    m_stack.push_back( approver );
+                }
+            }
+        );
+    }
+
+    return weight + 1;
+
+}
+
+void TangleSnapshot::setWeightThreads( int threads, long parallelThreshold )
+{
+    m_weightThreads = std::max( 1, threads );
+    m_parallelThreshold = parallelThreshold;
+}
+
+void TangleSnapshot::resetClaimed()
+{
+
+    long words = ( size() + 63 ) / 64;
+
+    if( words > m_claimedWords )
+    {
+        m_claimed.reset( new std::atomic<uint64_t>[words] );
+        m_claimedWords = words;
+    }
+
+    for( long i = 0; i < words; ++i )
+    {
+        m_claimed[i].store( 0, std::memory_order_relaxed );
+    }
+
+}
+
+// True for the one caller that sets row's bit
+bool TangleSnapshot::claim( uint32_t row )
+{
+    std::atomic<uint64_t>& word = m_claimed[row / 64];
+    uint64_t bit = uint64_t( 1 ) << ( row % 64 );
+
+    //plain load first, most rows deep in a cone are reached through several approvers
+    if( word.load( std::memory_order_relaxed ) & bit )
+    {
+        return false;
+    }
+
+    return !( word.fetch_or( bit, std::memory_order_relaxed ) & bit );
+}
+
+// computeWeight split across m_weightThreads workers, the calling thread being worker 0. outstanding counts rows
+// claimed but not yet expanded - a batch adds its new rows before removing its expanded ones, so it only reaches
+// zero once the whole cone has been expanded
+int TangleSnapshot::computeWeightParallel( long index, double viewTime )
+{
+
+    int threads = m_weightThreads;
+
+    resetClaimed();
+    claim( index );
+
+    std::vector<StealDeque> deques( threads );
+    std::vector<long> reached( threads, 0 );
+    std::atomic<long> outstanding( 1 );
+    std::atomic<int> idle( 0 );
+
+    deques[0].rows.push_back( index );
+
+    auto worker = [&]( int self )
+    {
+        std::vector<uint32_t> stack;
+        long count = 0;
+        bool isIdle = false;
+
+        while( outstanding.load( std::memory_order_acquire ) > 0 )
+        {
+
+            if( stack.empty() && !takeWork( deques, self, stack ) )
+            {
+                if( !isIdle )
+                {
+                    isIdle = true;
+                    idle.fetch_add( 1 );
+                }
+
+                std::this_thread::yield();
+                continue;
+            }
+
+            if( isIdle )
+            {
+                isIdle = false;
+                idle.fetch_sub( 1 );
+            }
+
+            long expanded = 0;
+            long added = 0;
+
+            while( !stack.empty() && expanded < PARALLEL_BATCH )
+            {
+                uint32_t current = stack.back();
+                stack.pop_back();
+                ++expanded;
+
+                if( timeStamp[current] > viewTime )
+                {
+                    continue;
+                }
+
+                forEachApprover( current, [&]( uint32_t approver )
+                    {
+                        if( claim( approver ) )
+                        {
+                            stack.push_back( approver );
+                            ++added;
+                        }
+                    }
+                );
+            }
+
+            count += added;
+            outstanding.fetch_add( added - expanded, std::memory_order_acq_rel );
+
+            //share the older half of the stack while someone is waiting for work
+            if( idle.load( std::memory_order_relaxed ) > 0 && stack.size() > 1 )
+            {
+                size_t share = stack.size() / 2;
+                std::lock_guard<std::mutex> guard( deques[self].lock );
+
+                deques[self].rows.insert( deques[self].rows.end(), stack.begin(), stack.begin() + share );
+                stack.erase( stack.begin(), stack.begin() + share );
+            }
+
+        }
+
+        if( isIdle )
+        {
+            idle.fetch_sub( 1 );
+        }
+
+        reached[self] = count;
+    };
+
+    std::vector<std::thread> helpers;
+
+    for( int i = 1; i < threads; ++i )
+    {
+        helpers.emplace_back( worker, i );
+    }
+
+    worker( 0 );
+
+    for( auto& helper : helpers )
+    {
+        helper.join();
+    }
+
+    long weight = 0;
+
+    for( auto count : reached )
+    {
+        weight += count;
+    }
+
+    return weight + 1;
+
+}
+
+//TangleSnapshot def END
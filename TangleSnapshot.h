@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Tangle.h"
+
+// Compressed sparse row copy of the tangle's approves / approved by adjacency with the per Tx fields analytics
+// read kept in parallel arrays, so bulk traversals stream through contiguous memory instead of chasing t_ptrTx.
+// Rows are indexed by Tx::m_tangleIndex. update() only appends the transactions attached since the last call and
+// refreshes the ones that were still tips. Their approvals go on per row delta lists, which are merged into the
+// approved by rows once they hold a quarter as many edges, so keeping the snapshot current costs O(1) per edge
+class TangleSnapshot
+{
+
+    public:
+        // Brings the snapshot up to date with tn
+        void update( const Tangle& tn );
+
+        long size() const;
+
+        // Same result as TxActor::ComputeWeight on the tangle the snapshot was last updated from. Queries whose cone
+        // could reach parallelThreshold or more rows are split across the weight threads
+        int computeWeight( long index, omnetpp::simtime_t timeStamp );
+
+        // threads <= 1 keeps every weight query on the calling thread
+        void setWeightThreads( int threads, long parallelThreshold );
+
+        // Per transaction fields, indexed by Tx::m_tangleIndex
+        std::vector<long> txNumber;
+        std::vector<double> timeStamp;
+        std::vector<double> firstApprovedTime;
+        std::vector<uint8_t> orphaned; // dropped from the tips by the tip expiry policy
+
+        // Transactions approved by row i are approves[approvesOffset[i] .. approvesOffset[i + 1])
+        std::vector<uint64_t> approvesOffset;
+        std::vector<uint32_t> approves;
+
+        // Transactions approving row i as of the last merge are approvedBy[approvedByOffset[i] .. approvedByOffset[i + 1]),
+        // in attach order. Later approvers are on the delta lists, forEachApprover visits both
+        std::vector<uint64_t> approvedByOffset;
+        std::vector<uint32_t> approvedBy;
+
+        int approverCount( long index ) const;
+
+        // Calls visit( approver ) for every row approving row, in attach order
+        template <typename Visit>
+        void forEachApprover( uint32_t row, Visit visit ) const
+        {
+            for( uint64_t e = approvedByOffset[row]; e < approvedByOffset[row + 1]; ++e )
+            {
+                visit( approvedBy[e] );
+            }
+
+            for( uint32_t d = m_deltaHead[row]; d != NO_EDGE; d = m_deltaNext[d] )
+            {
+                visit( m_deltaApprover[d] );
+            }
+        }
+
+    private:
+        static const uint32_t NO_EDGE = UINT32_MAX;
+
+        // Approvals since the last merge as linked lists per approved row - m_deltaHead[i] and m_deltaTail[i] index
+        // m_deltaApprover / m_deltaNext, NO_EDGE for none
+        std::vector<uint32_t> m_deltaHead;
+        std::vector<uint32_t> m_deltaTail;
+        std::vector<uint32_t> m_deltaApprover;
+        std::vector<uint32_t> m_deltaNext;
+
+        // Rows whose firstApprovedTime was not yet set at the last update
+        std::vector<long> m_unapproved;
+        std::vector<t_ptrTx> m_unapprovedTx;
+
+        // computeWeight marks rows with the current epoch instead of clearing a visited flag per query
+        std::vector<uint32_t> m_visitEpoch;
+        uint32_t m_epoch = 0;
+        std::vector<uint32_t> m_stack;
+
+        // Parallel traversal state - workers claim rows by setting their bit, so each row is counted once
+        int m_weightThreads = 1;
+        long m_parallelThreshold = 0;
+        std::unique_ptr<std::atomic<uint64_t>[]> m_claimed;
+        long m_claimedWords = 0;
+
+        int computeWeightParallel( long index, double viewTime );
+        void resetClaimed();
+        bool claim( uint32_t row );
+
+        void appendRow( t_ptrTx tx );
+        void addDeltaApprover( uint32_t row, uint32_t approver );
+        void rebuildApprovedBy();
+
+};
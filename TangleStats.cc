@@ -0,0 +1,349 @@
+#include "TangleStats.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+}
+
+/*
+    STREAMINGHISTOGRAM DEFINITIONS
+*/
+
+StreamingHistogram::StreamingHistogram( double binWidth, int binCount ) : m_binWidth( binWidth ), m_bins( std::max( 1, binCount ), 0 )
+{
+}
+
+void StreamingHistogram::add( double value )
+{
+    long bin = value < 0.0 ? 0 : static_cast<long>( value / m_binWidth );
+
+    if( bin < m_bins.size() )
+    {
+        ++m_bins[bin];
+    }
+    else
+    {
+        ++m_overflow;
+    }
+
+    if( m_count == 0 || value > m_max )
+    {
+        m_max = value;
+    }
+
+    ++m_count;
+    m_sum += value;
+}
+
+long StreamingHistogram::getCount() const
+{
+    return m_count;
+}
+
+double StreamingHistogram::getMean() const
+{
+    return m_count > 0 ? m_sum / m_count : 0.0;
+}
+
+double StreamingHistogram::getMax() const
+{
+    return m_max;
+}
+
+void StreamingHistogram::write( std::ostream& out, const std::string& prefix ) const
+{
+    for( int i = 0; i < m_bins.size(); ++i )
+    {
+        if( m_bins[i] > 0 )
+        {
+            out << prefix << i * m_binWidth << "," << m_bins[i] << "\n";
+        }
+    }
+
+    if( m_overflow > 0 )
+    {
+        out << prefix << m_bins.size() * m_binWidth << "," << m_overflow << "\n";
+    }
+}
+
+//StreamingHistogram def END
+
+/*
+    TDIGEST DEFINITIONS
+*/
+
+TDigest::TDigest( double compression ) : m_compression( compression ), m_bufferLimit( static_cast<int>( compression ) * 5 )
+{
+}
+
+void TDigest::add( double value )
+{
+    if( m_totalWeight == 0.0 && m_buffer.empty() )
+    {
+        m_min = value;
+        m_max = value;
+    }
+
+    m_min = std::min( m_min, value );
+    m_max = std::max( m_max, value );
+
+    m_buffer.push_back( { value, 1.0 } );
+
+    if( m_buffer.size() >= m_bufferLimit )
+    {
+        compress();
+    }
+}
+
+// k1 scale function - keeps centroids small near the tails so extreme quantiles stay accurate
+double TDigest::kScale( double q ) const
+{
+    return m_compression / ( 2.0 * PI ) * std::asin( 2.0 * q - 1.0 );
+}
+
+double TDigest::kScaleInverse( double k ) const
+{
+    double angle = std::min( PI / 2.0, 2.0 * PI * k / m_compression );
+    return ( std::sin( angle ) + 1.0 ) / 2.0;
+}
+
+void TDigest::compress()
+{
+    if( m_buffer.empty() )
+    {
+        return;
+    }
+
+    for( auto& centroid : m_buffer )
+    {
+        m_totalWeight += centroid.weight;
+    }
+
+    m_buffer.insert( m_buffer.end(), m_centroids.begin(), m_centroids.end() );
+    std::sort( m_buffer.begin(), m_buffer.end(), [] ( const Centroid& left, const Centroid& right )
+        {
+            return left.mean < right.mean;
+        }
+    );
+
+    m_centroids.clear();
+
+    Centroid current = m_buffer.front();
+    double weightSoFar = 0.0;
+    double qLimit = kScaleInverse( kScale( 0.0 ) + 1.0 );
+
+    for( int i = 1; i < m_buffer.size(); ++i )
+    {
+        const Centroid& next = m_buffer[i];
+        double q = ( weightSoFar + current.weight + next.weight ) / m_totalWeight;
+
+        if( q <= qLimit )
+        {
+            current.mean += ( next.mean - current.mean ) * next.weight / ( current.weight + next.weight );
+            current.weight += next.weight;
+        }
+        else
+        {
+            weightSoFar += current.weight;
+            m_centroids.push_back( current );
+            qLimit = kScaleInverse( kScale( weightSoFar / m_totalWeight ) + 1.0 );
+            current = next;
+        }
+    }
+
+    m_centroids.push_back( current );
+    m_buffer.clear();
+}
+
+double TDigest::quantile( double q )
+{
+    compress();
+
+    if( m_centroids.empty() )
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    if( m_centroids.size() == 1 )
+    {
+        return m_centroids.front().mean;
+    }
+
+    double target = std::min( 1.0, std::max( 0.0, q ) ) * m_totalWeight;
+
+    //interpolate between centroid centres, treating min and max as the outer centres
+    double previousCentre = 0.0;
+    double previousMean = m_min;
+    double cumulative = 0.0;
+
+    for( auto& centroid : m_centroids )
+    {
+        double centre = cumulative + centroid.weight / 2.0;
+
+        if( target < centre )
+        {
+            double fraction = ( target - previousCentre ) / ( centre - previousCentre );
+            return previousMean + fraction * ( centroid.mean - previousMean );
+        }
+
+        previousCentre = centre;
+        previousMean = centroid.mean;
+        cumulative += centroid.weight;
+    }
+
+    if( m_totalWeight <= previousCentre )
+    {
+        return m_max;
+    }
+
+    double fraction = ( target - previousCentre ) / ( m_totalWeight - previousCentre );
+    return previousMean + fraction * ( m_max - previousMean );
+}
+
+//TDigest def END
+
+/*
+    WINDOWEDMEAN DEFINITIONS
+*/
+
+WindowedMean::WindowedMean( omnetpp::simtime_t windowLength ) : m_windowLength( windowLength )
+{
+}
+
+void WindowedMean::add( double value, omnetpp::simtime_t time )
+{
+    long window = static_cast<long>( std::floor( time / m_windowLength ) );
+
+    Accumulator& acc = m_open[window];
+    ++acc.count;
+    acc.sum += value;
+
+    m_latest = std::max( m_latest, window );
+}
+
+std::vector<WindowedMean::Window> WindowedMean::takeCompleted( bool flushAll )
+{
+    std::vector<Window> completed;
+
+    auto end = flushAll ? m_open.end() : m_open.lower_bound( m_latest - 1 );
+
+    for( auto it = m_open.begin(); it != end; ++it )
+    {
+        completed.push_back( { m_windowLength * it->first, it->second.count, it->second.sum / it->second.count } );
+    }
+
+    m_open.erase( m_open.begin(), end );
+
+    return completed;
+}
+
+//WindowedMean def END
+
+void StreamingMetric::add( double value, omnetpp::simtime_t time )
+{
+    histogram.add( value );
+    digest.add( value );
+    windowed.add( value, time );
+}
+
+/*
+    TANGLESTATS DEFINITIONS
+*/
+
+TangleStats::TangleStats()
+{
+    m_approvers.resize( 1, 0 );
+}
+
+void TangleStats::configure( double tipAgeBinWidth, double tipCountBinWidth, int binCount, omnetpp::simtime_t windowLength )
+{
+    m_tipAge.histogram = StreamingHistogram( tipAgeBinWidth, binCount );
+    m_tipAge.windowed = WindowedMean( windowLength );
+
+    m_tipCount.histogram = StreamingHistogram( tipCountBinWidth, binCount );
+    m_tipCount.windowed = WindowedMean( windowLength );
+}
+
+void TangleStats::recordNewTx()
+{
+    ++m_approvers[0];
+    ++m_txCount;
+}
+
+void TangleStats::recordApproval( int previousApprovers )
+{
+    if( previousApprovers + 1 >= m_approvers.size() )
+    {
+        m_approvers.resize( previousApprovers + 2, 0 );
+    }
+
+    --m_approvers[previousApprovers];
+    ++m_approvers[previousApprovers + 1];
+    ++m_approvals;
+}
+
+void TangleStats::recordTipAge( omnetpp::simtime_t tipAge, omnetpp::simtime_t approvedTime )
+{
+    m_tipAge.add( tipAge.dbl(), approvedTime );
+}
+
+void TangleStats::recordTipCount( int tipCount, omnetpp::simtime_t time )
+{
+    m_tipCount.add( tipCount, time );
+}
+
+void TangleStats::recordOrphan()
+{
+    ++m_orphans;
+}
+
+void TangleStats::recordOrphanApproved()
+{
+    --m_orphans;
+}
+
+void TangleStats::writeHeader( std::ostream& out )
+{
+    out << "Row,TxCount,Metric,Count,Mean,P50,P90,P99,Max" << std::endl;
+    out << "# hist rows: Row,TxCount,Metric,Bin Start,Count - window rows: Row,TxCount,Metric,Window Start,Count,Mean" << std::endl;
+}
+
+void TangleStats::writeMetric( std::ostream& out, long txCount, const char* name, StreamingMetric& metric, bool final )
+{
+    out << "summary," << txCount << "," << name << "," << metric.histogram.getCount() << "," << metric.histogram.getMean() << ","
+        << metric.digest.quantile( 0.5 ) << "," << metric.digest.quantile( 0.9 ) << "," << metric.digest.quantile( 0.99 ) << ","
+        << metric.histogram.getMax() << "\n";
+
+    metric.histogram.write( out, "hist," + std::to_string( txCount ) + "," + name + "," );
+
+    for( auto& window : metric.windowed.takeCompleted( final ) )
+    {
+        out << "window," << txCount << "," << name << "," << window.start << "," << window.count << "," << window.mean << "\n";
+    }
+}
+
+void TangleStats::write( std::ostream& out, long txCount, bool final )
+{
+    writeMetric( out, txCount, "TipAge", m_tipAge, final );
+    writeMetric( out, txCount, "TipCount", m_tipCount, final );
+
+    out << "summary," << txCount << ",DirectApprovers," << m_txCount << "," << ( m_txCount > 0 ? double( m_approvals ) / m_txCount : 0.0 ) << ",,,,"
+        << m_approvers.size() - 1 << "\n";
+
+    out << "summary," << txCount << ",Orphaned," << m_orphans << ",,,,,\n";
+
+    for( int i = 0; i < m_approvers.size(); ++i )
+    {
+        if( m_approvers[i] > 0 )
+        {
+            out << "hist," << txCount << ",DirectApprovers," << i << "," << m_approvers[i] << "\n";
+        }
+    }
+
+    out.flush();
+}
+
+//TangleStats def END
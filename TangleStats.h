@@ -0,0 +1,159 @@
+#pragma once
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <omnetpp.h>
+
+// Fixed width histogram over [0, binWidth * binCount), anything beyond lands in the overflow bin
+class StreamingHistogram
+{
+
+    public:
+        StreamingHistogram( double binWidth = 1.0, int binCount = 100 );
+
+        void add( double value );
+
+        long getCount() const;
+        double getMean() const;
+        double getMax() const;
+
+        // One "<bin start>,<count>" pair per non-empty bin, overflow written with a start of binWidth * binCount
+        void write( std::ostream& out, const std::string& prefix ) const;
+
+    private:
+        double m_binWidth;
+        std::vector<long> m_bins;
+        long m_overflow = 0;
+
+        long m_count = 0;
+        double m_sum = 0.0;
+        double m_max = 0.0;
+
+};
+
+// Merging t-digest (Dunning) for streaming quantiles, memory is bounded by the compression factor
+class TDigest
+{
+
+    public:
+        TDigest( double compression = 100.0 );
+
+        void add( double value );
+
+        // Returns NaN when nothing has been added
+        double quantile( double q );
+
+    private:
+        struct Centroid
+        {
+            double mean;
+            double weight;
+        };
+
+        double m_compression;
+        int m_bufferLimit;
+        std::vector<Centroid> m_centroids;
+        std::vector<Centroid> m_buffer;
+
+        double m_totalWeight = 0.0;
+        double m_min = 0.0;
+        double m_max = 0.0;
+
+        // Merges m_buffer into m_centroids
+        void compress();
+
+        double kScale( double q ) const;
+        double kScaleInverse( double k ) const;
+
+};
+
+// Mean per fixed simulation time window, only windows that can still receive values are held
+class WindowedMean
+{
+
+    public:
+        struct Window
+        {
+            omnetpp::simtime_t start;
+            long count;
+            double mean;
+        };
+
+        WindowedMean( omnetpp::simtime_t windowLength = 10.0 );
+
+        void add( double value, omnetpp::simtime_t time );
+
+        // Removes and returns finished windows - all of them if flushAll, otherwise all but the two most recent
+        // as values are recorded against Tx timestamps, which may trail the newest window by up to the POW time
+        std::vector<Window> takeCompleted( bool flushAll );
+
+    private:
+        struct Accumulator
+        {
+            long count = 0;
+            double sum = 0.0;
+        };
+
+        omnetpp::simtime_t m_windowLength;
+        std::map<long, Accumulator> m_open;
+        long m_latest = 0;
+
+};
+
+// Histogram, quantiles and windowed mean of one quantity
+struct StreamingMetric
+{
+    StreamingHistogram histogram;
+    TDigest digest;
+    WindowedMean windowed;
+
+    void add( double value, omnetpp::simtime_t time );
+};
+
+// Online replacement for the raw per transaction tip data, fed by TxActor::attach
+class TangleStats
+{
+
+    public:
+        TangleStats();
+
+        // Replaces the accumulators - call before the first transaction is recorded
+        void configure( double tipAgeBinWidth, double tipCountBinWidth, int binCount, omnetpp::simtime_t windowLength );
+
+        // A transaction was added to the tangle, it starts with no direct approvers
+        void recordNewTx();
+
+        // tx gained an approver, previousApprovers is how many it had before
+        void recordApproval( int previousApprovers );
+
+        // A tip was approved for the first time, tipAge being firstApprovedTime - timeStamp
+        void recordTipAge( omnetpp::simtime_t tipAge, omnetpp::simtime_t approvedTime );
+
+        void recordTipCount( int tipCount, omnetpp::simtime_t time );
+
+        // A tip was dropped by the tip expiry policy
+        void recordOrphan();
+
+        // A tip dropped by the tip expiry policy was approved after all
+        void recordOrphanApproved();
+
+        // Writes a summary, the histograms and any finished windows as csv rows tagged with txCount
+        void write( std::ostream& out, long txCount, bool final );
+
+        static void writeHeader( std::ostream& out );
+
+    private:
+        StreamingMetric m_tipAge;
+        StreamingMetric m_tipCount;
+
+        // Exact distribution of direct approvers - m_approvers[n] is how many transactions have n approvers
+        std::vector<long> m_approvers;
+        long m_approvals = 0;
+        long m_txCount = 0;
+        long m_orphans = 0;
+
+        void writeMetric( std::ostream& out, long txCount, const char* name, StreamingMetric& metric, bool final );
+
+};
@@ -0,0 +1,160 @@
+#include "TangleStorage.h"
+#include <algorithm>
+#include <functional>
+#include <new>
+
+#ifdef TANGLE_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+    TXARENA DEFINITIONS
+*/
+
+TxArena::~TxArena()
+{
+
+#ifdef TANGLE_HAS_MMAP
+    for( auto chunk : m_chunks )
+    {
+        munmap( chunk, m_chunkBytes );
+    }
+
+    if( m_fd >= 0 )
+    {
+        close( m_fd );
+        unlink( m_path.c_str() );
+    }
+#endif
+
+}
+
+bool TxArena::open( const std::string& path, std::size_t slotSize, std::size_t chunkBytes )
+{
+
+#ifdef TANGLE_HAS_MMAP
+    if( isOpen() || slotSize == 0 )
+    {
+        return false;
+    }
+
+    //whole pages per chunk, so chunks can be evicted independently
+    std::size_t page = sysconf( _SC_PAGESIZE );
+    chunkBytes = std::max( chunkBytes, slotSize );
+    chunkBytes = ( chunkBytes + page - 1 ) / page * page;
+
+    m_fd = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+
+    if( m_fd < 0 )
+    {
+        return false;
+    }
+
+    m_path = path;
+    m_slotSize = slotSize;
+    m_chunkBytes = chunkBytes;
+    m_slotsPerChunk = chunkBytes / slotSize;
+
+    return true;
+#else
+    return false;
+#endif
+
+}
+
+bool TxArena::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+void* TxArena::allocate()
+{
+
+    if( m_used == m_chunks.size() * m_slotsPerChunk )
+    {
+        addChunk();
+    }
+
+    std::size_t chunk = m_used / m_slotsPerChunk;
+    std::size_t offset = ( m_used % m_slotsPerChunk ) * m_slotSize;
+    ++m_used;
+
+    return m_chunks[chunk] + offset;
+
+}
+
+void TxArena::addChunk()
+{
+
+#ifdef TANGLE_HAS_MMAP
+    off_t fileSize = off_t( m_chunks.size() + 1 ) * m_chunkBytes;
+
+    if( ftruncate( m_fd, fileSize ) != 0 )
+    {
+        throw std::bad_alloc();
+    }
+
+    void* chunk = mmap( nullptr, m_chunkBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, fileSize - m_chunkBytes );
+
+    if( chunk == MAP_FAILED )
+    {
+        throw std::bad_alloc();
+    }
+
+    m_chunks.push_back( static_cast<char*>( chunk ) );
+    m_sortedChunks.insert( std::upper_bound( m_sortedChunks.begin(), m_sortedChunks.end(), m_chunks.back() ), m_chunks.back() );
+#else
+    throw std::bad_alloc();
+#endif
+
+}
+
+bool TxArena::contains( const void* p ) const
+{
+
+    //the last chunk starting at or before p is the only one that can hold it
+    const char* address = static_cast<const char*>( p );
+    auto after = std::upper_bound( m_sortedChunks.begin(), m_sortedChunks.end(), address, std::less<const char*>() );
+
+    return after != m_sortedChunks.begin() && address < *( after - 1 ) + m_chunkBytes;
+
+}
+
+void TxArena::evictBefore( std::size_t slot )
+{
+
+#ifdef TANGLE_HAS_MMAP
+    std::size_t coldChunks = isOpen() ? slot / m_slotsPerChunk : 0;
+
+    while( m_evictedChunks < coldChunks )
+    {
+        char* chunk = m_chunks[m_evictedChunks];
+
+        //write back first, dropping a shared mapping's pages is then only a matter of unmapping them
+        msync( chunk, m_chunkBytes, MS_ASYNC );
+
+#ifdef MADV_PAGEOUT
+        madvise( chunk, m_chunkBytes, MADV_PAGEOUT );
+#else
+        madvise( chunk, m_chunkBytes, MADV_DONTNEED );
+#endif
+
+        ++m_evictedChunks;
+    }
+#endif
+
+}
+
+std::size_t TxArena::size() const
+{
+    return m_used;
+}
+
+std::size_t TxArena::getEvictedChunks() const
+{
+    return m_evictedChunks;
+}
+
+//TxArena def END
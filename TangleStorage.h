@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Memory mapped files need POSIX mmap, elsewhere TxArena::open fails and transactions stay on the heap
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define TANGLE_HAS_MMAP 1
+#endif
+
+// Fixed size slots carved from a file on local disk, mapped a chunk at a time so slot addresses never move.
+// Pages of the file are ordinary shared file pages - the OS writes them back and drops them under memory
+// pressure, or when evictBefore() asks, and faults them back in on the next access. Slots are handed out in
+// order and never reused, the file is removed when the arena is destroyed
+class TxArena
+{
+
+    public:
+        TxArena() = default;
+        TxArena( const TxArena& ) = delete;
+        TxArena& operator=( const TxArena& ) = delete;
+        ~TxArena();
+
+        // Creates path as the backing file for slots of slotSize bytes, mapped chunkBytes at a time. False if the
+        // file cannot be created or this platform has no mmap
+        bool open( const std::string& path, std::size_t slotSize, std::size_t chunkBytes );
+        bool isOpen() const;
+
+        // Storage for one slot, throws std::bad_alloc if the file cannot grow
+        void* allocate();
+
+        bool contains( const void* p ) const;
+
+        // Writes back and drops from memory every whole chunk holding only slots before slot
+        void evictBefore( std::size_t slot );
+
+        // Slots handed out so far
+        std::size_t size() const;
+        std::size_t getEvictedChunks() const;
+
+    private:
+        int m_fd = -1;
+        std::string m_path;
+
+        std::size_t m_slotSize = 0;
+        std::size_t m_chunkBytes = 0;
+        std::size_t m_slotsPerChunk = 0;
+
+        std::vector<char*> m_chunks;
+        std::vector<char*> m_sortedChunks; // by address, for contains()
+        std::size_t m_used = 0;
+        std::size_t m_evictedChunks = 0;
+
+        void addChunk();
+
+};
@@ -0,0 +1,334 @@
+#include "TangleTrace.h"
+#include "TangleStorage.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef TANGLE_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char TRACE_MAGIC[8] = { 'T', 'A', 'N', 'G', 'T', 'R', 'C', '1' };
+    const std::size_t TRACE_RECORD_BYTES = 24;
+
+    // How far ahead of the current record the OS is asked to read, and how much behind it is kept
+    const std::size_t TRACE_WINDOW = std::size_t( 16 ) << 20;
+
+    // The whole of text as a number, false if any of it is not
+    // Times the replay can schedule - strtod and binary records alike can hold negative, NaN and infinite values,
+    // which would otherwise only fail once scheduled, with no trace position to go on
+    bool validTimes( const TraceRecord& record )
+    {
+        return std::isfinite( record.issueTime ) && record.issueTime >= 0.0
+            && std::isfinite( record.powTime ) && record.powTime >= 0.0;
+    }
+
+    bool parseNumber( const char* text, uint32_t& value )
+    {
+        char* end;
+        errno = 0;
+        unsigned long long parsed = std::strtoull( text, &end, 10 );
+
+        if( !( text[0] >= '0' && text[0] <= '9' ) || *end != '\0' || errno == ERANGE || parsed > UINT32_MAX )
+        {
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+
+    bool parseNumber( const char* text, double& value )
+    {
+        char* end;
+        value = std::strtod( text, &end );
+
+        return end != text && *end == '\0';
+    }
+
+    // One comma or line terminated field, advancing pos past the field and its separator. The field is copied out
+    // before parsing, the mapped trace has no terminating null to stop strtod at
+    template <typename T>
+    bool parseField( const char* data, std::size_t size, std::size_t& pos, T& value )
+    {
+        while( pos < size && ( data[pos] == ' ' || data[pos] == '\t' ) )
+        {
+            ++pos;
+        }
+
+        std::size_t start = pos;
+
+        while( pos < size && data[pos] != ',' && data[pos] != ' ' && data[pos] != '\t' && data[pos] != '\r' )
+        {
+            ++pos;
+        }
+
+        char text[64];
+
+        if( pos == start || pos - start >= sizeof( text ) )
+        {
+            return false;
+        }
+
+        std::memcpy( text, data + start, pos - start );
+        text[pos - start] = '\0';
+
+        if( !parseNumber( text, value ) )
+        {
+            return false;
+        }
+
+        while( pos < size && ( data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' ) )
+        {
+            ++pos;
+        }
+
+        if( pos < size && data[pos] == ',' )
+        {
+            ++pos;
+        }
+
+        return true;
+    }
+}
+
+/*
+    TRACEREADER DEFINITIONS
+*/
+
+TraceReader::~TraceReader()
+{
+
+#ifdef TANGLE_HAS_MMAP
+    if( m_data != nullptr )
+    {
+        munmap( const_cast<char*>( m_data ), m_size );
+    }
+
+    if( m_fd >= 0 )
+    {
+        close( m_fd );
+    }
+#endif
+
+}
+
+bool TraceReader::open( const std::string& path )
+{
+
+#ifdef TANGLE_HAS_MMAP
+    m_fd = ::open( path.c_str(), O_RDONLY );
+
+    if( m_fd < 0 )
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+
+    struct stat info;
+
+    if( fstat( m_fd, &info ) != 0 )
+    {
+        m_error = "cannot stat " + path;
+        return false;
+    }
+
+    m_size = info.st_size;
+
+    if( m_size > 0 )
+    {
+        void* data = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+
+        if( data == MAP_FAILED )
+        {
+            m_error = "cannot map " + path;
+            return false;
+        }
+
+        m_data = static_cast<const char*>( data );
+        madvise( data, m_size, MADV_SEQUENTIAL );
+    }
+
+    m_binary = m_size >= sizeof( TRACE_MAGIC ) && std::memcmp( m_data, TRACE_MAGIC, sizeof( TRACE_MAGIC ) ) == 0;
+    m_pos = m_binary ? sizeof( TRACE_MAGIC ) : 0;
+
+    if( m_binary && ( m_size - m_pos ) % TRACE_RECORD_BYTES != 0 )
+    {
+        m_error = path + " is truncated";
+        return false;
+    }
+
+    adviseWindow();
+
+    return true;
+#else
+    m_error = "trace replay needs mmap, not available on this platform";
+    return false;
+#endif
+
+}
+
+bool TraceReader::next( TraceRecord& record )
+{
+
+    if( m_pos >= m_size || !m_error.empty() )
+    {
+        return false;
+    }
+
+    bool read = m_binary ? nextBinary( record ) : nextCsv( record );
+
+    if( read )
+    {
+        ++m_records;
+        adviseWindow();
+    }
+
+    return read;
+
+}
+
+bool TraceReader::nextBinary( TraceRecord& record )
+{
+
+    //bytes 4 to 8 are reserved
+    std::memcpy( &record.issuer, m_data + m_pos, sizeof( uint32_t ) );
+    std::memcpy( &record.issueTime, m_data + m_pos + 8, sizeof( double ) );
+    std::memcpy( &record.powTime, m_data + m_pos + 16, sizeof( double ) );
+
+    m_pos += TRACE_RECORD_BYTES;
+
+    if( !validTimes( record ) )
+    {
+        m_error = "negative or non finite time in trace record " + std::to_string( m_records + 1 );
+        return false;
+    }
+
+    return true;
+
+}
+
+bool TraceReader::nextCsv( TraceRecord& record )
+{
+
+    while( m_pos < m_size )
+    {
+        std::size_t end = std::find( m_data + m_pos, m_data + m_size, '\n' ) - m_data;
+        std::size_t pos = m_pos;
+        ++m_line;
+
+        m_pos = end + 1;
+
+        while( pos < end && ( m_data[pos] == ' ' || m_data[pos] == '\t' || m_data[pos] == '\r' ) )
+        {
+            ++pos;
+        }
+
+        //blank lines, comments, and a header - any line before the first record not starting with a digit
+        if( pos == end || m_data[pos] == '#' || ( m_records == 0 && !( m_data[pos] >= '0' && m_data[pos] <= '9' ) ) )
+        {
+            continue;
+        }
+
+        if( !parseField( m_data, end, pos, record.issuer ) || !parseField( m_data, end, pos, record.issueTime )
+            || !parseField( m_data, end, pos, record.powTime ) || pos != end )
+        {
+            m_error = "malformed trace record on line " + std::to_string( m_line );
+            return false;
+        }
+
+        if( !validTimes( record ) )
+        {
+            m_error = "negative or non finite time in trace record on line " + std::to_string( m_line );
+            return false;
+        }
+
+        return true;
+    }
+
+    return false;
+
+}
+
+void TraceReader::adviseWindow()
+{
+
+#ifdef TANGLE_HAS_MMAP
+    if( m_data == nullptr )
+    {
+        return;
+    }
+
+    std::size_t page = sysconf( _SC_PAGESIZE );
+    char* base = const_cast<char*>( m_data );
+
+    //ask for the next window once the current record is within one window of the end of the last request
+    if( m_pos + TRACE_WINDOW > m_advisedTo && m_advisedTo < m_size )
+    {
+        std::size_t from = m_advisedTo / page * page;
+        m_advisedTo = std::min( m_size, m_pos + 2 * TRACE_WINDOW );
+
+        madvise( base + from, m_advisedTo - from, MADV_WILLNEED );
+    }
+
+    //drop whole pages more than a window behind
+    if( m_pos > m_releasedTo + 2 * TRACE_WINDOW )
+    {
+        std::size_t to = ( m_pos - TRACE_WINDOW ) / page * page;
+
+        madvise( base + m_releasedTo, to - m_releasedTo, MADV_DONTNEED );
+        m_releasedTo = to;
+    }
+#endif
+
+}
+
+const std::string& TraceReader::getError() const
+{
+    return m_error;
+}
+
+long TraceReader::getRecordCount() const
+{
+    return m_records;
+}
+
+//TraceReader def END
+
+/*
+    TRACEWRITER DEFINITIONS
+*/
+
+bool TraceWriter::open( const std::string& path )
+{
+    m_out.open( path, std::ios::binary | std::ios::trunc );
+    m_out.write( TRACE_MAGIC, sizeof( TRACE_MAGIC ) );
+
+    return m_out.good();
+}
+
+void TraceWriter::write( const TraceRecord& record )
+{
+    uint32_t reserved = 0;
+
+    m_out.write( reinterpret_cast<const char*>( &record.issuer ), sizeof( uint32_t ) );
+    m_out.write( reinterpret_cast<const char*>( &reserved ), sizeof( uint32_t ) );
+    m_out.write( reinterpret_cast<const char*>( &record.issueTime ), sizeof( double ) );
+    m_out.write( reinterpret_cast<const char*>( &record.powTime ), sizeof( double ) );
+}
+
+bool TraceWriter::close()
+{
+    m_out.close();
+
+    return !m_out.fail();
+}
+
+//TraceWriter def END
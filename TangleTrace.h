@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// One recorded transaction: which issuer started it, when, and how long its POW took
+struct TraceRecord
+{
+    uint32_t issuer = 0;
+    double issueTime = 0.0;
+    double powTime = 0.0;
+};
+
+// Streams arrival records from a trace file in issue time order. The file is memory mapped and read front to
+// back - the OS is asked to read ahead a window past the current record and to drop what is more than a window
+// behind it, so a trace of any size costs nothing up front and a bounded amount of memory while replaying.
+//
+// Issue and POW times must be finite and non negative, a record with any other time is reported like a malformed one.
+// Two formats are read:
+//  - binary, written by TraceWriter: the 8 byte magic "TANGTRC1" then fixed 24 byte records
+//    ( uint32 issuer, uint32 reserved, double issueTime, double powTime ) in host byte order
+//  - CSV, one "issuer,issueTime,powTime" record per line. Blank lines, lines starting with # and a header
+//    line are skipped, times are in seconds
+class TraceReader
+{
+
+    public:
+        TraceReader() = default;
+        TraceReader( const TraceReader& ) = delete;
+        TraceReader& operator=( const TraceReader& ) = delete;
+        ~TraceReader();
+
+        // False if the file cannot be mapped, getError() says why
+        bool open( const std::string& path );
+
+        // Reads the next record, false at the end of the trace or on a malformed or out of range record - getError()
+        // is empty at the end of the trace
+        bool next( TraceRecord& record );
+
+        const std::string& getError() const;
+
+        // Records read so far
+        long getRecordCount() const;
+
+    private:
+        int m_fd = -1;
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+        std::size_t m_pos = 0;
+        bool m_binary = false;
+
+        // [m_releasedTo, m_advisedTo) is the window the OS has been asked to keep resident
+        std::size_t m_advisedTo = 0;
+        std::size_t m_releasedTo = 0;
+
+        long m_records = 0;
+        long m_line = 0;
+        std::string m_error;
+
+        bool nextBinary( TraceRecord& record );
+        bool nextCsv( TraceRecord& record );
+        void adviseWindow();
+
+};
+
+// Appends records to a binary trace, for converting CSV traces or recording synthetic workloads
+class TraceWriter
+{
+
+    public:
+        bool open( const std::string& path );
+        void write( const TraceRecord& record );
+        bool close();
+
+    private:
+        std::ofstream m_out;
+
+};
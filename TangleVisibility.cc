@@ -0,0 +1,98 @@
+#include "TangleVisibility.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+/*
+    TANGLEVISIBILITY DEFINITIONS
+*/
+
+bool TangleVisibility::configure( const std::string& matrix )
+{
+
+    m_regions = 0;
+    m_delays.clear();
+
+    std::vector<std::vector<double>> rows;
+    std::stringstream rowStream( matrix );
+    std::string row;
+
+    while( std::getline( rowStream, row, ';' ) )
+    {
+        for( auto& c : row )
+        {
+            if( c == ',' )
+            {
+                c = ' ';
+            }
+        }
+
+        std::stringstream entries( row );
+        std::vector<double> delays;
+        std::string entry;
+
+        while( entries >> entry )
+        {
+            char* end;
+            double delay = std::strtod( entry.c_str(), &end );
+
+            if( *end != '\0' || delay < 0 )
+            {
+                return false;
+            }
+
+            delays.push_back( delay );
+        }
+
+        //allows a trailing ';'
+        if( !delays.empty() )
+        {
+            rows.push_back( delays );
+        }
+    }
+
+    int regions = rows.size();
+
+    if( regions > 256 )
+    {
+        return false;
+    }
+
+    for( auto& delays : rows )
+    {
+        if( int( delays.size() ) != regions )
+        {
+            return false;
+        }
+    }
+
+    //shortest paths, a transaction travels the fastest way the network offers and never arrives before its parents.
+    //The diagonal is kept, it is the delay between nodes of the same region
+    for( int via = 0; via < regions; ++via )
+    {
+        for( int from = 0; from < regions; ++from )
+        {
+            for( int to = 0; to < regions; ++to )
+            {
+                rows[from][to] = std::min( rows[from][to], rows[from][via] + rows[via][to] );
+            }
+        }
+    }
+
+    m_delays.reserve( regions * regions );
+
+    for( auto& delays : rows )
+    {
+        for( auto delay : delays )
+        {
+            m_delays.push_back( delay );
+        }
+    }
+
+    m_regions = regions;
+
+    return true;
+
+}
+
+//TangleVisibility def END
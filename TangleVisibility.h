@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <omnetpp.h>
+
+// Per node propagation delays without per node copies of the tangle. Nodes and transactions each carry a one
+// byte region, and a transaction issued at t in region a is visible to the nodes of region b from
+// t + delay( a, b ). The delays are closed under shortest paths when configured, so a transaction's parents
+// always reach a region no later than the transaction itself does - no node sees a transaction without its
+// parents. Unconfigured, every transaction is visible everywhere from its timeStamp
+class TangleVisibility
+{
+
+    public:
+        // Reads a square matrix of one way delays in seconds, rows separated by ';' and entries by spaces or
+        // commas - row a, column b is the delay from region a to region b. An empty string disables the layer.
+        // False, with the layer left disabled, if the matrix is malformed, not square, negative or has more
+        // than 256 regions
+        bool configure( const std::string& matrix );
+
+        bool isEnabled() const { return m_regions > 0; }
+        int getRegionCount() const { return m_regions; }
+
+        omnetpp::simtime_t getDelay( uint8_t from, uint8_t to ) const { return m_delays[from * m_regions + to]; }
+
+        // Can nodes in region see a transaction issued at issued in region origin, at time
+        bool isVisible( omnetpp::simtime_t issued, uint8_t origin, uint8_t region, omnetpp::simtime_t time ) const
+        {
+            return issued + m_delays[origin * m_regions + region] <= time;
+        }
+
+    private:
+        int m_regions = 0;
+        std::vector<omnetpp::simtime_t> m_delays;
+
+};
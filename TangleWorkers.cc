@@ -0,0 +1,111 @@
+#include "TangleWorkers.h"
+#include <algorithm>
+
+/*
+    TANGLEWORKERPOOL DEFINITIONS
+*/
+
+TangleWorkerPool::TangleWorkerPool( int threads, int maxUnfinished )
+{
+
+    if( threads <= 0 )
+    {
+        threads = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+
+    m_maxUnfinished = maxUnfinished > 0 ? maxUnfinished : 4 * threads;
+
+    for( int i = 0; i < threads; ++i )
+    {
+        m_threads.emplace_back( &TangleWorkerPool::run, this );
+    }
+
+}
+
+TangleWorkerPool::~TangleWorkerPool()
+{
+
+    {
+        std::lock_guard<std::mutex> guard( m_lock );
+        m_stopping = true;
+    }
+
+    m_jobQueued.notify_all();
+
+    for( auto& thread : m_threads )
+    {
+        thread.join();
+    }
+
+}
+
+void TangleWorkerPool::submit( std::function<void()> job )
+{
+
+    std::unique_lock<std::mutex> guard( m_lock );
+
+    //back pressure on the caller - a burst of submissions cannot pile up unbounded work ahead of the threads
+    m_jobFinished.wait( guard, [this]() { return m_unfinished < m_maxUnfinished; } );
+
+    m_jobs.push_back( std::move( job ) );
+    ++m_unfinished;
+    m_peakUnfinished = std::max( m_peakUnfinished, m_unfinished );
+
+    guard.unlock();
+    m_jobQueued.notify_one();
+
+}
+
+void TangleWorkerPool::wait()
+{
+    std::unique_lock<std::mutex> guard( m_lock );
+    m_jobFinished.wait( guard, [this]() { return m_unfinished == 0; } );
+}
+
+int TangleWorkerPool::getThreadCount() const
+{
+    return m_threads.size();
+}
+
+int TangleWorkerPool::getMaxUnfinished() const
+{
+    return m_maxUnfinished;
+}
+
+long TangleWorkerPool::getPeakUnfinished() const
+{
+    std::lock_guard<std::mutex> guard( m_lock );
+    return m_peakUnfinished;
+}
+
+void TangleWorkerPool::run()
+{
+
+    std::unique_lock<std::mutex> guard( m_lock );
+
+    while( true )
+    {
+        m_jobQueued.wait( guard, [this]() { return m_stopping || !m_jobs.empty(); } );
+
+        //only stop once the queue is empty, so every submitted job runs
+        if( m_jobs.empty() )
+        {
+            return;
+        }
+
+        std::function<void()> job = std::move( m_jobs.front() );
+        m_jobs.pop_front();
+
+        guard.unlock();
+        job();
+        guard.lock();
+
+        --m_unfinished;
+
+        //both a blocked submit and wait may be waiting on the count
+        m_jobFinished.notify_all();
+    }
+
+}
+
+//TangleWorkerPool def END
@@ -0,0 +1,52 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running submitted jobs. The threads live as long as the pool, so the thread_local scratch
+// tip selection keeps per thread (weight marks, cone merge state) is sized once and reused by every job after,
+// instead of being allocated and zeroed for each job as a thread per job would
+class TangleWorkerPool
+{
+
+    public:
+        // threads <= 0 uses one per hardware thread. maxUnfinished <= 0 allows four jobs per thread to be queued or running
+        TangleWorkerPool( int threads, int maxUnfinished );
+
+        // Runs the jobs still queued, then joins the threads
+        ~TangleWorkerPool();
+
+        TangleWorkerPool( const TangleWorkerPool& ) = delete;
+        TangleWorkerPool& operator=( const TangleWorkerPool& ) = delete;
+
+        // Queues job for the next free thread. Blocks first while maxUnfinished jobs are queued or running
+        void submit( std::function<void()> job );
+
+        // Returns once every job submitted so far has finished
+        void wait();
+
+        int getThreadCount() const;
+        int getMaxUnfinished() const;
+
+        // Most jobs that have been queued or running at once
+        long getPeakUnfinished() const;
+
+    private:
+        std::vector<std::thread> m_threads;
+        std::deque<std::function<void()>> m_jobs;
+
+        mutable std::mutex m_lock;
+        std::condition_variable m_jobQueued; // workers wait here for jobs, or for the pool to stop
+        std::condition_variable m_jobFinished; // submit and wait wait here
+
+        long m_unfinished = 0; // queued or running
+        long m_peakUnfinished = 0;
+        int m_maxUnfinished;
+        bool m_stopping = false;
+
+        void run();
+
+};
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""End to end scaling benchmark for the TangleSim network.
+
+Runs the simulation once per point in the txActorNumber x transactionLimit x
+tipSelectionMethod grid and writes one JSON record per run with events/sec,
+wall time per attached transaction, peak RSS and bytes of output written.
+
+    ./run_scaling.py --sim ../TangleSim --actors 10 100 --limits 1000 10000 \
+        --methods URTS WALK KWALK --out scaling.json
+"""
+
+import argparse
+import datetime
+import itertools
+import json
+import os
+import platform
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPO = os.path.dirname(HERE)
+
+# Cmdenv prints the event number in its progress lines and when endSimulation() is called
+EVENT_RE = re.compile(r"[Ee]vent #(\d+)")
+
+
+def run_once(args, network, actors, limit, method, run_dir):
+    os.makedirs(run_dir, exist_ok=True)
+
+    def out(name):
+        return os.path.join(run_dir, name)
+
+    cmd = [
+        args.sim,
+        "-u", "Cmdenv",
+        "-n", args.ned_path,
+        "-f", args.ini,
+        "--network=%s" % network,
+        "--result-dir=%s" % out("results"),
+        "--%s.txActorNumber=%d" % (network, actors),
+        "--**.transactionLimit=%d" % limit,
+        "--**.tipSelectionMethod=\"%s\"" % method,
+        "--**.tipDataFilename=\"%s\"" % out("TipData.txt"),
+        "--**.tipAgeFilename=\"%s\"" % out("TipAge.txt"),
+        "--**.blockWeightFilename=\"%s\"" % out("BlockWeight.txt"),
+        "--**.tipStatsFilename=\"%s\"" % out("TipStats.txt"),
+    ] + args.extra
+
+    start = time.perf_counter()
+    with open(out("stdout.txt"), "w") as log:
+        proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT, cwd=run_dir)
+        # wait4 gives the resource usage of this child alone, unlike getrusage(RUSAGE_CHILDREN)
+        _, status, usage = os.wait4(proc.pid, 0)
+        proc.returncode = os.waitstatus_to_exitcode(status)
+    wall = time.perf_counter() - start
+
+    events = 0
+    with open(out("stdout.txt")) as log:
+        for line in log:
+            for match in EVENT_RE.finditer(line):
+                events = max(events, int(match.group(1)))
+
+    output_bytes = 0
+    for root, _, files in os.walk(run_dir):
+        for name in files:
+            if name != "stdout.txt":
+                output_bytes += os.path.getsize(os.path.join(root, name))
+
+    # ru_maxrss is in kilobytes on Linux and bytes on macOS
+    rss_scale = 1 if sys.platform == "darwin" else 1024
+
+    return {
+        "network": network,
+        "txActorNumber": actors,
+        "transactionLimit": limit,
+        "tipSelectionMethod": method,
+        "exitCode": proc.returncode,
+        "wallSeconds": wall,
+        "events": events,
+        "eventsPerSecond": events / wall if wall > 0 else 0.0,
+        "wallSecondsPerTx": wall / limit if limit > 0 else 0.0,
+        "peakRssBytes": usage.ru_maxrss * rss_scale,
+        "outputBytes": output_bytes,
+    }
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "HEAD"], cwd=REPO, text=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sim", default=os.path.join(REPO, "TangleSim"), help="simulation executable")
+    parser.add_argument("--ned-path", default=REPO, help="directory holding TangleSim.ned")
+    parser.add_argument("--ini", default=os.path.join(HERE, "scaling.ini"))
+    parser.add_argument("--networks", nargs="+", default=["TangleSim"],
+                        help="networks to run, e.g. TangleSim TangleSimAggregated")
+    parser.add_argument("--actors", nargs="+", type=int, default=[10, 100, 1000])
+    parser.add_argument("--limits", nargs="+", type=int, default=[1000, 10000])
+    parser.add_argument("--methods", nargs="+", default=["URTS", "WALK", "KWALK"])
+    parser.add_argument("--work-dir", default=os.path.join(HERE, "runs"), help="per run output directories")
+    parser.add_argument("--keep-output", action="store_true", help="keep run directories after measuring them")
+    parser.add_argument("--out", default=os.path.join(HERE, "scaling.json"))
+    parser.add_argument("extra", nargs="*", help="further options passed to every run, after --")
+    args = parser.parse_args()
+
+    args.sim = os.path.abspath(args.sim)
+    args.ned_path = os.path.abspath(args.ned_path)
+    args.ini = os.path.abspath(args.ini)
+
+    runs = []
+    grid = itertools.product(args.networks, args.actors, args.limits, args.methods)
+
+    for network, actors, limit, method in grid:
+        run_dir = os.path.join(args.work_dir, "%s-%d-%d-%s" % (network, actors, limit, method))
+        print("%s actors=%d limit=%d method=%s ... " % (network, actors, limit, method), end="", flush=True)
+
+        record = run_once(args, network, actors, limit, method, run_dir)
+        runs.append(record)
+
+        print("%.2fs, %.0f ev/s, %.1f MiB peak" % (record["wallSeconds"], record["eventsPerSecond"],
+                                                  record["peakRssBytes"] / 2**20))
+
+        if not args.keep_output:
+            shutil.rmtree(run_dir, ignore_errors=True)
+
+    report = {
+        "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "revision": git_revision(),
+        "host": platform.node(),
+        "platform": platform.platform(),
+        "runs": runs,
+    }
+
+    with open(args.out, "w") as f:
+        json.dump(report, f, indent=2)
+
+    print("wrote %s" % args.out)
+    return 0 if all(run["exitCode"] == 0 for run in runs) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,160 @@
+// Checks that TxActor::findMaxWeightIndex and findMaxWeightIndexExact pick the same approver as the original
+// comparison loop, copied verbatim below as baselineFindMaxWeightIndex, over walk steps sampled from generated
+// tangles. Walks compare approver weights only through findMaxWeightIndex, and none of the routines draw random
+// numbers, so equal picks here mean EasyWalkTipSelection and WalkTipSelection make the same choices they always have.
+//
+// Not part of the simulation build. Compile it with the pure C++ sources against OMNeT++, e.g. from this directory
+//   g++ -std=c++17 -I.. -I$OMNETPP_ROOT/include FindMaxWeightTest.cc ../Tangle.cc ../TangleGenerator.cc ../TangleStats.cc
+//       ../TangleRng.cc ../TangleStorage.cc ../TangleVisibility.cc -L$OMNETPP_ROOT/lib -loppsim -pthread
+// It prints one line per case and exits non zero on any mismatch.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Tangle.h"
+#include "TangleGenerator.h"
+
+namespace
+{
+
+    // TxActor::findMaxWeightIndex as first written, the reference every walk step is checked against
+    int baselineFindMaxWeightIndex( TxActor& actor, std::vector<t_ptrTx>& view, omnetpp::simtime_t timeStamp )
+    {
+        int maxWeight = 0;
+        int maxWeightIndex = 0;
+
+        for( int i = 0; i < view.size(); ++i )
+        {
+            int weight = actor.ComputeWeight( view.at( i ), timeStamp );
+
+            if( weight > maxWeight )
+            {
+                maxWeightIndex = i;
+            }
+
+        }
+
+        return maxWeightIndex;
+    }
+
+    struct Result
+    {
+        long compared = 0;
+        long mismatched = 0;
+    };
+
+    // Runs the routines on the visible approvers of sampled transactions, as a walk step at a sampled view time
+    // would see them. reference never caches, tested does when useCache is set - walk selections always cache
+    Result compare( Tangle& tn, TxActor& reference, TxActor& tested, TangleRng& gen, int samples, bool useCache )
+    {
+        Result result;
+
+        for( int s = 0; s < samples; ++s )
+        {
+            t_ptrTx tx = tn.allTx[gen.bounded( tn.allTx.size() )];
+            omnetpp::simtime_t viewTime = tn.allTx[gen.bounded( tn.allTx.size() )]->timeStamp;
+
+            std::vector<t_ptrTx> view = tx->m_approvedBy;
+            tested.filterView( view, viewTime );
+
+            if( view.size() < 2 )
+            {
+                continue;
+            }
+
+            int expected = baselineFindMaxWeightIndex( reference, view, viewTime );
+
+            if( useCache )
+            {
+                tested.startWeightCache( viewTime );
+            }
+
+            //twice, so a second lookup within one selection also goes through the cache
+            int first = tested.findMaxWeightIndex( view, viewTime );
+            int second = tested.findMaxWeightIndex( view, viewTime );
+            int exact = tested.findMaxWeightIndexExact( view, viewTime );
+
+            if( useCache )
+            {
+                tested.clearWeightCache();
+            }
+
+            ++result.compared;
+
+            if( first != expected || second != expected || exact != expected )
+            {
+                ++result.mismatched;
+                std::printf( "  Tx #%ld at %g: expected %d, got %d then %d, exact loop %d\n", tx->TxNumber, viewTime.dbl(), expected,
+                        first, second, exact );
+            }
+        }
+
+        return result;
+    }
+
+}
+
+int main()
+{
+
+    long mismatched = 0;
+
+    for( std::string method : { "URTS", "WALK", "KWALK" } )
+    {
+        Tx::tx_totalCount = 0;
+        Tangle tn;
+
+        TangleGenerator::Params params;
+        params.txCount = method == "URTS" ? 20000 : 5000;
+        params.arrivalRate = 50;
+        params.powDelay = 0.1;
+        params.actorCount = 10;
+        params.method = tipSelectionMethodFromString( method );
+        params.alphaVal = 0.5;
+        params.walkDepth = 5;
+        params.seed = 7;
+
+        TangleGenerator generator( tn, params );
+        generator.generate();
+
+        TangleRng gen( 11 );
+
+        //second pass with the visibility layer, the transactors in region 1 see every Tx 0.3s late
+        for( int pass = 0; pass < 2; ++pass )
+        {
+            if( pass == 1 && !tn.visibility.configure( "0 0.3; 0.3 0" ) )
+            {
+                std::printf( "could not configure regions\n" );
+                return 1;
+            }
+
+            TxActor reference;
+            TxActor tested;
+
+            reference.setTanglePtr( &tn );
+            tested.setTanglePtr( &tn );
+            reference.setRegion( pass );
+            tested.setRegion( pass );
+
+            for( bool useCache : { false, true } )
+            {
+                Result result = compare( tn, reference, tested, gen, 4000, useCache );
+                mismatched += result.mismatched;
+
+                std::printf( "%-5s %-8s %-8s %ld walk steps compared, %ld mismatched\n", method.c_str(), pass == 0 ? "shared" : "regions",
+                        useCache ? "cached" : "uncached", result.compared, result.mismatched );
+            }
+        }
+
+        for( auto tx : tn.allTx )
+        {
+            tn.destroyTx( tx );
+        }
+
+        tn.destroyTx( tn.giveGenBlock() );
+    }
+
+    return mismatched == 0 ? 0 : 1;
+
+}